@@ -1,5 +1,14 @@
 #!/bin/bash
 
+# usage: ./build.sh [gl3|gl3clip|gles3|headless|sessions|glcompare]
+#   gl3       OpenGL 3.3 core renderer (renderer_gl3.c)
+#   gl3clip   the gl3 renderer clipping in its shader (R_VERTEX_CLIP)
+#   gles3     OpenGL ES 3.0 renderer (renderer_gl3.c built with R_GLES)
+#   headless  software rendered benchmark, needs neither SDL nor GL
+#   sessions  session host benchmark (sessionhost.c), needs neither SDL nor GL
+#   glcompare compares the gl3, gl3clip and gles3 renderers with the software
+#             rasterizer without a window (EGL surfaceless, e.g. Mesa llvmpipe)
+
 OS_NAME=`uname -o 2>/dev/null || uname -s`
 
 if [ $OS_NAME == "Msys" ]; then
@@ -10,7 +19,37 @@ else
     GLFLAG="-lGL"
 fi
 
-CFLAGS="-I../src -Wall -std=c11 -pedantic `sdl2-config --libs` $GLFLAG -lm -O3 -g"
+if [ "$1" == "headless" ]; then
+    gcc headless.c swrender.c swtiles.c glyphcache.c ../src/microui/microui.c ../src/microui/demo.c \
+        -I../src -Wall -std=c11 -pedantic -pthread -lm -O3 -g -o headless
+    exit
+fi
+
+if [ "$1" == "sessions" ]; then
+    gcc sessions.c sessionhost.c sharedfont.c glyphcache.c swrender.c ../src/microui/microui.c ../src/microui/demo.c \
+        -DMU_EXTERNAL_STORAGE -DMU_INBOX -I../src -Wall -std=c11 -pedantic -pthread -lm -O3 -g -o sessions
+    exit
+fi
 
-gcc main.c renderer.c ../src/microui/microui.c ../src/microui/demo.c $CFLAGS
+if [ "$1" == "glcompare" ]; then
+    SRC="glcompare.c renderer_gl3.c glyphcache.c swrender.c ../src/microui/microui.c ../src/microui/demo.c"
+    CFLAGS="-DR_HEADLESS -I../src -Wall -std=c11 -pedantic -lm -O3 -g"
+    gcc $SRC $CFLAGS -lEGL -lGL -o glcompare_gl3
+    gcc $SRC $CFLAGS -DR_VERTEX_CLIP -lEGL -lGL -o glcompare_gl3clip
+    gcc $SRC $CFLAGS -DR_GLES -lEGL -lGLESv2 -o glcompare_gles3
+    exit
+fi
+
+RENDERER="renderer.c glyphcache.c"
+if [ "$1" == "gl3" ]; then
+    RENDERER="renderer_gl3.c glyphcache.c"
+elif [ "$1" == "gl3clip" ]; then
+    RENDERER="renderer_gl3.c glyphcache.c -DR_VERTEX_CLIP"
+elif [ "$1" == "gles3" ]; then
+    RENDERER="renderer_gl3.c glyphcache.c -DR_GLES"
+    GLFLAG="-lGLESv2"
+fi
+
+CFLAGS="-I../src -Wall -std=c11 -pedantic `sdl2-config --libs` $GLFLAG -lm -O3 -g"
 
+gcc main.c $RENDERER ../src/microui/microui.c ../src/microui/demo.c $CFLAGS
@@ -0,0 +1,133 @@
+/*
+** Renders the demo with renderer_gl3.c built with R_HEADLESS and with the
+** software rasterizer (swrender.c), replaying the same input script, and
+** compares the two frame by frame. Exits with failure if any channel of any
+** pixel differs by more than `tolerance`, which allows for the GPU's
+** rounding when blending. Run it on Mesa's llvmpipe with
+** LIBGL_ALWAYS_SOFTWARE=1 to check the renderer without a GPU.
+**
+** usage: ./glcompare [frames] [tolerance] [mode]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "renderer.h"
+#include "swrender.h"
+#include "microui/microui.h"
+#include "microui/demo.h"
+
+enum { WIDTH = 800, HEIGHT = 600 };
+
+static unsigned char gl_pixels[WIDTH * HEIGHT * 4];
+static unsigned char sw_pixels[WIDTH * HEIGHT * 4];
+
+
+static int text_width(mu_Font font, const char *text, int len) {
+  if (len == -1) { len = strlen(text); }
+  return r_get_text_width(font, text, len);
+}
+
+
+static int text_height(mu_Font font) {
+  return r_get_text_height(font);
+}
+
+
+static void input_script(mu_Context *ctx, int frame) {
+  /* sweep the mouse over the windows, clicking now and then */
+  int x = 100 + (frame * 9) % 600;
+  int y = 60 + (frame * 5) % 450;
+  mu_input_mousemove(ctx, x, y);
+  if (frame % 20 == 5) { mu_input_mousedown(ctx, x, y, MU_MOUSE_LEFT); }
+  if (frame % 20 == 8) { mu_input_mouseup(ctx, x, y, MU_MOUSE_LEFT); }
+  /* translucent windows and buttons for the second half */
+  if (frame == 30) {
+    ctx->style->colors[MU_COLOR_WINDOWBG].a = 180;
+    ctx->style->colors[MU_COLOR_BUTTON].a = 100;
+  }
+}
+
+
+static void render_gl(mu_Context *ctx, mu_Color bg) {
+  mu_Command *cmd = NULL;
+  int i;
+  r_clear(bg);
+  while (mu_next_command(ctx, &cmd)) {
+    switch (cmd->type) {
+      case MU_COMMAND_TEXT: r_draw_text(cmd->text.font, cmd->text.str, cmd->text.pos, cmd->text.color); break;
+      case MU_COMMAND_RECT: r_draw_rect(cmd->rect.rect, cmd->rect.color); break;
+      case MU_COMMAND_ICON: r_draw_icon(cmd->icon.id, cmd->icon.rect, cmd->icon.color); break;
+      case MU_COMMAND_CLIP: r_set_clip_rect(cmd->clip.rect); break;
+      case MU_COMMAND_BOX: r_draw_box(cmd->box.rect, cmd->box.color); break;
+      case MU_COMMAND_FRAME: {
+        mu_Rect r = cmd->frame.rect;
+        r_draw_rect(r, cmd->frame.color);
+        r_draw_box(mu_rect(r.x - 1, r.y - 1, r.w + 2, r.h + 2), cmd->frame.border);
+        break;
+      }
+      case MU_COMMAND_RECT_BATCH:
+        for (i = 0; i < cmd->rect_batch.count; i++) {
+          r_draw_rect(cmd->rect_batch.rects[i], cmd->rect_batch.color);
+        }
+        break;
+      case MU_COMMAND_ICON_BATCH:
+        for (i = 0; i < cmd->icon_batch.count; i++) {
+          r_draw_icon(cmd->icon_batch.id, cmd->icon_batch.rects[i], cmd->icon_batch.color);
+        }
+        break;
+    }
+  }
+  r_present();
+  r_read_pixels(gl_pixels);
+}
+
+
+int main(int argc, char **argv) {
+  int i, frames = argc > 1 ? atoi(argv[1]) : 60;
+  int tolerance = argc > 2 ? atoi(argv[2]) : 2;
+  int worst = 0, bad_frames = 0;
+  sw_Canvas canvas;
+
+  mu_Context *ctx = malloc(sizeof(mu_Context));
+  mu_init(ctx);
+  ctx->text_width = text_width;
+  ctx->text_height = text_height;
+  ctx->mode = argc > 3 ? atoi(argv[3]) : 0;
+  r_init();
+  sw_init(&canvas, sw_pixels, WIDTH, HEIGHT);
+
+  for (i = 0; i < frames; i++) {
+    mu_Color bg;
+    int j, diff = 0;
+    input_script(ctx, i);
+    mu_begin(ctx);
+    mu_demo(ctx);
+    if (mu_begin_window(ctx, "UTF-8", mu_rect(500, 420, 200, 80))) {
+      mu_label(ctx, "h\xc3\xa9llo \xe2\x9c\x93 w\xc3\xb6rld");
+      mu_end_window(ctx);
+    }
+    mu_end(ctx);
+
+    bg = mu_color(mu_demo_bg[0], mu_demo_bg[1], mu_demo_bg[2], 255);
+    render_gl(ctx, bg);
+    sw_clear(&canvas, bg);
+    sw_render(&canvas, ctx);
+
+    /* alpha is left out, the software canvas does not track it */
+    for (j = 0; j < WIDTH * HEIGHT * 4; j++) {
+      if (j % 4 == 3) { continue; }
+      diff = mu_max(diff, abs(gl_pixels[j] - sw_pixels[j]));
+    }
+    if (diff > tolerance) {
+      printf("frame %d: max channel difference %d\n", i, diff);
+      bad_frames++;
+    }
+    worst = mu_max(worst, diff);
+  }
+
+  printf("frames: %d\n", frames);
+  printf("max channel difference: %d\n", worst);
+  printf("frames over tolerance (%d): %d\n", tolerance, bad_frames);
+  return bad_frames ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,214 @@
+/*
+** Runtime glyph cache. Glyphs are requested from the font's source the first
+** time they are used and shelf-packed into fixed height pages of a single
+** coverage texture. When no page has room the least recently used page is
+** evicted as a whole; if it was used this frame the cache's `flush` callback
+** is called first so quads referring to it can be drawn. Rows below
+** `reserved` are left to the caller (the demo keeps its icons there).
+**
+** The cache only writes its CPU side pixel buffer; renderers upload the
+** rect returned by gc_get_dirty() before drawing.
+*/
+
+#include <string.h>
+#include "glyphcache.h"
+
+#define TABLE_SIZE (GC_MAX_GLYPHS * 2)
+
+
+static unsigned hash(gc_Font *font, unsigned codepoint) {
+  unsigned h = codepoint * 2654435761u;
+  return h ^ (unsigned) ((size_t) font >> 4);
+}
+
+
+/* returns the table slot holding the glyph, or the empty slot it belongs in */
+static int find(gc_Cache *gc, gc_Font *font, unsigned codepoint) {
+  int i = hash(font, codepoint) & (TABLE_SIZE - 1);
+  for (;;) {
+    int n = gc->table[i];
+    if (n == 0) { return i; }
+    if (gc->glyphs[n - 1].font == font && gc->glyphs[n - 1].codepoint == codepoint) {
+      return i;
+    }
+    i = (i + 1) & (TABLE_SIZE - 1);
+  }
+}
+
+
+static void evict_page(gc_Cache *gc, int page) {
+  gc_Page *p = &gc->pages[page];
+  int i, n = 0;
+  /* quads batched earlier this frame may still sample this page, so the
+  ** renderer draws them before its glyphs are overwritten */
+  if (p->last_used == gc->frame && gc->flush) { gc->flush(gc->flush_udata); }
+  p->used = 0;
+  p->shelf_count = 0;
+  /* drop the page's glyphs and rebuild the table from those left */
+  memset(gc->table, 0, sizeof(gc->table));
+  for (i = 0; i < gc->glyph_count; i++) {
+    if (gc->glyphs[i].page == page) { continue; }
+    gc->glyphs[n] = gc->glyphs[i];
+    gc->table[find(gc, gc->glyphs[n].font, gc->glyphs[n].codepoint)] = n + 1;
+    n++;
+  }
+  gc->glyph_count = n;
+}
+
+
+/* least recently used page holding glyphs; we only evict when every page
+** is full or the glyph array is, so there is always one */
+static int lru_page(gc_Cache *gc) {
+  int i, res = -1;
+  for (i = 0; i < gc->page_count; i++) {
+    if (gc->pages[i].used == 0) { continue; }
+    if (res < 0 || gc->pages[i].last_used < gc->pages[res].last_used) { res = i; }
+  }
+  return res;
+}
+
+
+/* places a w*h rect in `page`, reusing the tightest shelf which fits */
+static int pack(gc_Cache *gc, int page, int w, int h, mu_Rect *rect) {
+  gc_Page *p = &gc->pages[page];
+  gc_Shelf *best = NULL;
+  int i;
+  for (i = 0; i < p->shelf_count; i++) {
+    gc_Shelf *s = &p->shelves[i];
+    if (s->h < h || s->x + w > gc->width) { continue; }
+    if (!best || s->h < best->h) { best = s; }
+  }
+  if (!best) {
+    if (p->shelf_count == GC_MAX_SHELVES || p->used + h > GC_PAGE_HEIGHT) { return 0; }
+    best = &p->shelves[p->shelf_count++];
+    best->y = p->y + p->used;
+    best->h = h;
+    best->x = 0;
+    p->used += h;
+  }
+  *rect = mu_rect(best->x, best->y, w, h);
+  best->x += w;
+  return 1;
+}
+
+
+static void mark_dirty(gc_Cache *gc, mu_Rect r) {
+  if (gc->dirty.w == 0) { gc->dirty = r; return; }
+  {
+    int x1 = mu_min(gc->dirty.x, r.x);
+    int y1 = mu_min(gc->dirty.y, r.y);
+    int x2 = mu_max(gc->dirty.x + gc->dirty.w, r.x + r.w);
+    int y2 = mu_max(gc->dirty.y + gc->dirty.h, r.y + r.h);
+    gc->dirty = mu_rect(x1, y1, x2 - x1, y2 - y1);
+  }
+}
+
+
+void gc_init(gc_Cache *gc, unsigned char *pixels, int width, int height, int reserved) {
+  int i;
+  memset(gc, 0, sizeof(*gc));
+  gc->pixels = pixels;
+  gc->width = width;
+  gc->height = height;
+  gc->page_count = mu_min((height - reserved) / GC_PAGE_HEIGHT, GC_MAX_PAGES);
+  for (i = 0; i < gc->page_count; i++) {
+    gc->pages[i].y = reserved + i * GC_PAGE_HEIGHT;
+    gc->pages[i].last_used = -1;
+  }
+}
+
+
+void gc_next_frame(gc_Cache *gc) {
+  gc->frame++;
+}
+
+
+int gc_get_dirty(gc_Cache *gc, mu_Rect *rect) {
+  if (gc->dirty.w == 0) { return 0; }
+  *rect = gc->dirty;
+  gc->dirty = mu_rect(0, 0, 0, 0);
+  return 1;
+}
+
+
+const gc_Glyph* gc_get_glyph(gc_Font *font, unsigned codepoint) {
+  gc_Cache *gc = font->cache;
+  const unsigned char *src;
+  gc_Glyph *g;
+  mu_Rect rect;
+  int i, slot, page, w, h, pitch;
+
+  slot = find(gc, font, codepoint);
+  if (gc->table[slot]) {
+    g = &gc->glyphs[gc->table[slot] - 1];
+    gc->pages[g->page].last_used = gc->frame;
+    return g;
+  }
+
+  src = font->glyph(font->udata, codepoint, &w, &h, &pitch);
+  if (!src || w > gc->width || h > GC_PAGE_HEIGHT || gc->page_count == 0) { return NULL; }
+
+  /* find room, evicting the least recently used page if there is none */
+  page = -1;
+  if (gc->glyph_count < GC_MAX_GLYPHS) {
+    for (i = 0; i < gc->page_count; i++) {
+      if (pack(gc, i, w, h, &rect)) { page = i; break; }
+    }
+  }
+  if (page < 0) {
+    page = lru_page(gc);
+    evict_page(gc, page);
+    pack(gc, page, w, h, &rect);
+    slot = find(gc, font, codepoint);
+  }
+
+  /* copy the bitmap into the texture */
+  for (i = 0; i < h; i++) {
+    memcpy(gc->pixels + (rect.y + i) * gc->width + rect.x, src + i * pitch, w);
+  }
+  mark_dirty(gc, rect);
+
+  g = &gc->glyphs[gc->glyph_count++];
+  g->font = font;
+  g->codepoint = codepoint;
+  g->page = page;
+  g->rect = rect;
+  gc->table[slot] = gc->glyph_count;
+  gc->pages[page].last_used = gc->frame;
+  return g;
+}
+
+
+/* decodes one codepoint from at most `len` bytes (negative for no limit),
+** returning the number of bytes used or 0 at the end of the string */
+int gc_decode_utf8(const char *text, int len, unsigned *codepoint) {
+  const unsigned char *p = (const unsigned char*) text;
+  int i, n;
+  if (len == 0 || *p == 0) { return 0; }
+  if (p[0] < 0x80) { *codepoint = p[0]; return 1; }
+  if      ((p[0] & 0xe0) == 0xc0) { n = 2; *codepoint = p[0] & 0x1f; }
+  else if ((p[0] & 0xf0) == 0xe0) { n = 3; *codepoint = p[0] & 0x0f; }
+  else if ((p[0] & 0xf8) == 0xf0) { n = 4; *codepoint = p[0] & 0x07; }
+  else { *codepoint = 0xfffd; return 1; }
+  for (i = 1; i < n; i++) {
+    if ((len > 0 && i >= len) || (p[i] & 0xc0) != 0x80) {
+      *codepoint = 0xfffd;
+      return i;
+    }
+    *codepoint = (*codepoint << 6) | (p[i] & 0x3f);
+  }
+  return n;
+}
+
+
+int gc_text_width(gc_Font *font, const char *text, int len) {
+  int n, res = 0;
+  unsigned codepoint;
+  while ((n = gc_decode_utf8(text, len, &codepoint)) > 0) {
+    const gc_Glyph *g = gc_get_glyph(font, codepoint);
+    if (g) { res += g->rect.w; }
+    text += n;
+    if (len > 0) { len -= n; }
+  }
+  return res;
+}
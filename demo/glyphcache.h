@@ -0,0 +1,65 @@
+#ifndef GLYPHCACHE_H
+#define GLYPHCACHE_H
+
+#include "microui/microui.h"
+
+#define GC_MAX_GLYPHS   1024
+#define GC_MAX_PAGES    16
+#define GC_MAX_SHELVES  16
+#define GC_PAGE_HEIGHT  64
+
+/* returns the coverage bitmap (one byte per pixel, `pitch` bytes per row)
+** of `codepoint` and sets its size; sources should return a replacement
+** glyph rather than NULL for codepoints they do not cover */
+typedef const unsigned char* (*gc_GlyphFn)(void *udata, unsigned codepoint,
+  int *w, int *h, int *pitch);
+
+typedef struct gc_Cache gc_Cache;
+
+/* a font a `mu_Font` can point to: glyphs come from `glyph` and are packed
+** into `cache`, which may be shared by several fonts */
+typedef struct {
+  gc_Cache *cache;
+  gc_GlyphFn glyph;
+  void *udata;
+  int height;
+} gc_Font;
+
+typedef struct {
+  gc_Font *font;
+  unsigned codepoint;
+  int page;
+  mu_Rect rect;   /* location in the texture; rect.w is also the advance */
+} gc_Glyph;
+
+typedef struct { int y, h, x; } gc_Shelf;
+
+typedef struct {
+  int y, used;
+  int last_used;
+  int shelf_count;
+  gc_Shelf shelves[GC_MAX_SHELVES];
+} gc_Page;
+
+struct gc_Cache {
+  unsigned char *pixels;  /* width * height coverage texture */
+  int width, height;
+  int frame;
+  mu_Rect dirty;
+  void (*flush)(void *udata);
+  void *flush_udata;
+  int page_count;
+  gc_Page pages[GC_MAX_PAGES];
+  int glyph_count;
+  gc_Glyph glyphs[GC_MAX_GLYPHS];
+  short table[GC_MAX_GLYPHS * 2];
+};
+
+void gc_init(gc_Cache *gc, unsigned char *pixels, int width, int height, int reserved);
+void gc_next_frame(gc_Cache *gc);
+ int gc_get_dirty(gc_Cache *gc, mu_Rect *rect);
+const gc_Glyph* gc_get_glyph(gc_Font *font, unsigned codepoint);
+ int gc_decode_utf8(const char *text, int len, unsigned *codepoint);
+ int gc_text_width(gc_Font *font, const char *text, int len);
+
+#endif
@@ -0,0 +1,109 @@
+/*
+** Renders the demo without a window or GPU using the software rasterizer,
+** replaying a fixed input script so the output is reproducible. Prints
+** timings for building and rasterizing the command list and optionally
+** writes the last frame to a PPM image. With `threads` above 0 the frame is
+** rasterized by the tiled renderer (swtiles.c) using that many threads.
+**
+** usage: ./headless [frames] [threads] [output.ppm]
+*/
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "swrender.h"
+#include "microui/microui.h"
+#include "microui/demo.h"
+
+enum { WIDTH = 800, HEIGHT = 600 };
+
+static unsigned char pixels[WIDTH * HEIGHT * 4];
+
+
+static int text_width(mu_Font font, const char *text, int len) {
+  if (len == -1) { len = strlen(text); }
+  return sw_get_text_width(font, text, len);
+}
+
+
+static int text_height(mu_Font font) {
+  return sw_get_text_height(font);
+}
+
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static void input_script(mu_Context *ctx, int frame) {
+  /* sweep the mouse over the windows, clicking now and then */
+  int x = 60 + (frame * 7) % 600;
+  int y = 60 + (frame * 3) % 400;
+  mu_input_mousemove(ctx, x, y);
+  if (frame % 50 == 10) { mu_input_mousedown(ctx, x, y, MU_MOUSE_LEFT); }
+  if (frame % 50 == 12) { mu_input_mouseup(ctx, x, y, MU_MOUSE_LEFT); }
+}
+
+
+static void write_ppm(const char *filename) {
+  int i;
+  FILE *fp = fopen(filename, "wb");
+  if (!fp) { perror(filename); exit(EXIT_FAILURE); }
+  fprintf(fp, "P6 %d %d 255\n", WIDTH, HEIGHT);
+  for (i = 0; i < WIDTH * HEIGHT; i++) { fwrite(pixels + i * 4, 1, 3, fp); }
+  fclose(fp);
+}
+
+
+int main(int argc, char **argv) {
+  int i, frames = argc > 1 ? atoi(argv[1]) : 100;
+  int threads = argc > 2 ? atoi(argv[2]) : 0;
+  mu_Color bg = mu_color(mu_demo_bg[0], mu_demo_bg[1], mu_demo_bg[2], 255);
+  long commands = 0;
+  double t, build_time = 0, raster_time = 0;
+  sw_Canvas canvas;
+  sw_Tiler *tiler = threads > 0 ? sw_tiler_create(threads) : NULL;
+
+  mu_Context *ctx = malloc(sizeof(mu_Context));
+  mu_init(ctx);
+  ctx->text_width = text_width;
+  ctx->text_height = text_height;
+  ctx->style->font = sw_get_font();
+  ctx->mode = MU_MODE_BATCH;
+  sw_init(&canvas, pixels, WIDTH, HEIGHT);
+
+  for (i = 0; i < frames; i++) {
+    mu_Command *cmd = NULL;
+    input_script(ctx, i);
+
+    t = now();
+    mu_begin(ctx);
+    mu_demo(ctx);
+    mu_end(ctx);
+    build_time += now() - t;
+    while (mu_next_command(ctx, &cmd)) { commands++; }
+
+    t = now();
+    if (tiler) {
+      sw_render_tiled(tiler, &canvas, ctx, &bg);
+    } else {
+      sw_clear(&canvas, bg);
+      sw_render(&canvas, ctx);
+    }
+    raster_time += now() - t;
+  }
+
+  printf("frames: %d\n", frames);
+  printf("threads: %d\n", threads);
+  printf("commands/frame: %.1f\n", (double) commands / frames);
+  printf("build ms/frame: %.3f\n", build_time * 1000 / frames);
+  printf("raster ms/frame: %.3f\n", raster_time * 1000 / frames);
+  if (argc > 3) { write_ppm(argv[3]); }
+  if (tiler) { sw_tiler_destroy(tiler); }
+  return 0;
+}
@@ -4,10 +4,10 @@
 #include "microui/microui.h"
 #include "microui/demo.h"
 
-static void process_frame(mu_Context *ctx) {
+static int process_frame(mu_Context *ctx) {
   mu_begin(ctx);
   mu_demo(ctx);
-  mu_end(ctx);
+  return mu_end(ctx);
 }
 
 static const char button_map[256] = {
@@ -16,7 +16,7 @@ static const char button_map[256] = {
   [ SDL_BUTTON_MIDDLE & 0xff ] =  MU_MOUSE_MIDDLE,
 };
 
-static const char key_map[256] = {
+static const int key_map[256] = {
   [ SDLK_LSHIFT       & 0xff ] = MU_KEY_SHIFT,
   [ SDLK_RSHIFT       & 0xff ] = MU_KEY_SHIFT,
   [ SDLK_LCTRL        & 0xff ] = MU_KEY_CTRL,
@@ -25,15 +25,49 @@ static const char key_map[256] = {
   [ SDLK_RALT         & 0xff ] = MU_KEY_ALT,
   [ SDLK_RETURN       & 0xff ] = MU_KEY_RETURN,
   [ SDLK_BACKSPACE    & 0xff ] = MU_KEY_BACKSPACE,
+  [ SDLK_LEFT         & 0xff ] = MU_KEY_LEFT,
+  [ SDLK_RIGHT        & 0xff ] = MU_KEY_RIGHT,
+  [ SDLK_HOME         & 0xff ] = MU_KEY_HOME,
+  [ SDLK_END          & 0xff ] = MU_KEY_END,
+  [ SDLK_DELETE       & 0xff ] = MU_KEY_DELETE,
+  [ SDLK_UP           & 0xff ] = MU_KEY_UP,
+  [ SDLK_DOWN         & 0xff ] = MU_KEY_DOWN,
+  [ SDLK_PAGEUP       & 0xff ] = MU_KEY_PAGEUP,
+  [ SDLK_PAGEDOWN     & 0xff ] = MU_KEY_PAGEDOWN,
 };
 
 static int text_width(mu_Font font, const char *text, int len) {
   if (len == -1) { len = strlen(text); }
-  return r_get_text_width(text, len);
+  return r_get_text_width(font, text, len);
 }
 
 static int text_height(mu_Font font) {
-  return r_get_text_height();
+  return r_get_text_height(font);
+}
+
+static void handle_event(mu_Context *ctx, SDL_Event *e) {
+  switch (e->type) {
+    case SDL_QUIT: exit(EXIT_SUCCESS); break;
+    case SDL_MOUSEMOTION: mu_input_mousemove(ctx, e->motion.x, e->motion.y); break;
+    case SDL_MOUSEWHEEL: mu_input_scroll(ctx, 0, e->wheel.y * -30); break;
+    case SDL_TEXTINPUT: mu_input_text(ctx, e->text.text); break;
+
+    case SDL_MOUSEBUTTONDOWN:
+    case SDL_MOUSEBUTTONUP: {
+      int b = button_map[e->button.button & 0xff];
+      if (b && e->type == SDL_MOUSEBUTTONDOWN) { mu_input_mousedown(ctx, e->button.x, e->button.y, b); }
+      if (b && e->type ==   SDL_MOUSEBUTTONUP) { mu_input_mouseup(ctx, e->button.x, e->button.y, b);   }
+      break;
+    }
+
+    case SDL_KEYDOWN:
+    case SDL_KEYUP: {
+      int c = key_map[e->key.keysym.sym & 0xff];
+      if (c && e->type == SDL_KEYDOWN) { mu_input_keydown(ctx, c); }
+      if (c && e->type ==   SDL_KEYUP) { mu_input_keyup(ctx, c);   }
+      break;
+    }
+  }
 }
 
 int main(int argc, char **argv) {
@@ -46,48 +80,48 @@ int main(int argc, char **argv) {
   mu_init(ctx);
   ctx->text_width = text_width;
   ctx->text_height = text_height;
+  ctx->style->font = r_get_font();
+  ctx->mode = MU_MODE_BATCH | MU_MODE_LAZYCLIP | MU_MODE_CULL | MU_MODE_COALESCE;
 
   /* main loop */
+  int active = 1;
   for (;;) {
-    /* handle SDL events */
+    /* handle SDL events; when the last frame reported that nothing would
+    ** change without input, sleep until the next event arrives */
     SDL_Event e;
-    while (SDL_PollEvent(&e)) {
-      switch (e.type) {
-        case SDL_QUIT: exit(EXIT_SUCCESS); break;
-        case SDL_MOUSEMOTION: mu_input_mousemove(ctx, e.motion.x, e.motion.y); break;
-        case SDL_MOUSEWHEEL: mu_input_scroll(ctx, 0, e.wheel.y * -30); break;
-        case SDL_TEXTINPUT: mu_input_text(ctx, e.text.text); break;
-
-        case SDL_MOUSEBUTTONDOWN:
-        case SDL_MOUSEBUTTONUP: {
-          int b = button_map[e.button.button & 0xff];
-          if (b && e.type == SDL_MOUSEBUTTONDOWN) { mu_input_mousedown(ctx, e.button.x, e.button.y, b); }
-          if (b && e.type ==   SDL_MOUSEBUTTONUP) { mu_input_mouseup(ctx, e.button.x, e.button.y, b);   }
-          break;
-        }
-
-        case SDL_KEYDOWN:
-        case SDL_KEYUP: {
-          int c = key_map[e.key.keysym.sym & 0xff];
-          if (c && e.type == SDL_KEYDOWN) { mu_input_keydown(ctx, c); }
-          if (c && e.type ==   SDL_KEYUP) { mu_input_keyup(ctx, c);   }
-          break;
-        }
-      }
-    }
+    if (!active && SDL_WaitEvent(&e)) { handle_event(ctx, &e); }
+    while (SDL_PollEvent(&e)) { handle_event(ctx, &e); }
 
     /* process frame */
-    process_frame(ctx);
+    active = process_frame(ctx);
 
     /* render */
     r_clear(mu_color(mu_demo_bg[0], mu_demo_bg[1], mu_demo_bg[2], 255));
     mu_Command *cmd = NULL;
     while (mu_next_command(ctx, &cmd)) {
+      int i;
       switch (cmd->type) {
-        case MU_COMMAND_TEXT: r_draw_text(cmd->text.str, cmd->text.pos, cmd->text.color); break;
+        case MU_COMMAND_TEXT: r_draw_text(cmd->text.font, cmd->text.str, cmd->text.pos, cmd->text.color); break;
         case MU_COMMAND_RECT: r_draw_rect(cmd->rect.rect, cmd->rect.color); break;
         case MU_COMMAND_ICON: r_draw_icon(cmd->icon.id, cmd->icon.rect, cmd->icon.color); break;
         case MU_COMMAND_CLIP: r_set_clip_rect(cmd->clip.rect); break;
+        case MU_COMMAND_BOX: r_draw_box(cmd->box.rect, cmd->box.color); break;
+        case MU_COMMAND_FRAME: {
+          mu_Rect r = cmd->frame.rect;
+          r_draw_rect(r, cmd->frame.color);
+          r_draw_box(mu_rect(r.x - 1, r.y - 1, r.w + 2, r.h + 2), cmd->frame.border);
+          break;
+        }
+        case MU_COMMAND_RECT_BATCH:
+          for (i = 0; i < cmd->rect_batch.count; i++) {
+            r_draw_rect(cmd->rect_batch.rects[i], cmd->rect_batch.color);
+          }
+          break;
+        case MU_COMMAND_ICON_BATCH:
+          for (i = 0; i < cmd->icon_batch.count; i++) {
+            r_draw_icon(cmd->icon_batch.id, cmd->icon_batch.rects[i], cmd->icon_batch.color);
+          }
+          break;
       }
     }
     r_present();
@@ -2,10 +2,14 @@
 #include <SDL2/SDL_opengl.h>
 #include <assert.h>
 #include "renderer.h"
+#include "glyphcache.h"
 #include "atlas.inl"
 
 #define BUFFER_SIZE 16384
 
+/* atlas.inl is copied to the top of the texture, glyphs are cached below */
+enum { TEX_WIDTH = 256, TEX_HEIGHT = ATLAS_HEIGHT + 6 * GC_PAGE_HEIGHT };
+
 static GLfloat   tex_buf[BUFFER_SIZE *  8];
 static GLfloat  vert_buf[BUFFER_SIZE *  8];
 static GLubyte color_buf[BUFFER_SIZE * 16];
@@ -17,6 +21,40 @@ static int buf_idx;
 
 static SDL_Window *window;
 
+static unsigned char texture[TEX_WIDTH * TEX_HEIGHT];
+static gc_Cache glyph_cache;
+static gc_Font default_font;  /* used for text whose mu_Font is NULL */
+
+
+/* glyph source for the demo font: the ASCII glyphs of atlas.inl, with an
+** empty box standing in for every other codepoint */
+static const unsigned char* atlas_glyph(void *udata, unsigned codepoint,
+  int *w, int *h, int *pitch)
+{
+  static unsigned char tofu[7 * 17];
+  if (codepoint < 32 || codepoint > 127) {
+    if (!tofu[3 * 7 + 1]) {
+      for (int y = 3; y < 14; y++) {
+        for (int x = 1; x < 6; x++) {
+          tofu[y * 7 + x] = (y == 3 || y == 13 || x == 1 || x == 5) ? 255 : 0;
+        }
+      }
+    }
+    *w = 7; *h = 17; *pitch = 7;
+    return tofu;
+  }
+  mu_Rect src = atlas[ATLAS_FONT + codepoint];
+  *w = src.w; *h = src.h; *pitch = ATLAS_WIDTH;
+  return atlas_texture + src.y * ATLAS_WIDTH + src.x;
+}
+
+
+static void flush(void);
+
+static void flush_glyphs(void *udata) {
+  flush();
+}
+
 
 void r_init(void) {
   /* init SDL window */
@@ -36,12 +74,23 @@ void r_init(void) {
   glEnableClientState(GL_TEXTURE_COORD_ARRAY);
   glEnableClientState(GL_COLOR_ARRAY);
 
-  /* init texture */
+  /* init texture and glyph cache */
+  for (int y = 0; y < ATLAS_HEIGHT; y++) {
+    memcpy(texture + y * TEX_WIDTH, atlas_texture + y * ATLAS_WIDTH, ATLAS_WIDTH);
+  }
+  gc_init(&glyph_cache, texture, TEX_WIDTH, TEX_HEIGHT, ATLAS_HEIGHT);
+  glyph_cache.flush = flush_glyphs;
+  default_font.cache = &glyph_cache;
+  default_font.glyph = atlas_glyph;
+  default_font.height = 18;
+
   GLuint id;
   glGenTextures(1, &id);
   glBindTexture(GL_TEXTURE_2D, id);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, ATLAS_WIDTH, ATLAS_HEIGHT, 0,
-    GL_ALPHA, GL_UNSIGNED_BYTE, atlas_texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, TEX_WIDTH);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, TEX_WIDTH, TEX_HEIGHT, 0,
+    GL_ALPHA, GL_UNSIGNED_BYTE, texture);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
   assert(glGetError() == 0);
@@ -51,6 +100,13 @@ void r_init(void) {
 static void flush(void) {
   if (buf_idx == 0) { return; }
 
+  /* upload glyphs added since the last draw */
+  mu_Rect dirty;
+  if (gc_get_dirty(&glyph_cache, &dirty)) {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, dirty.x, dirty.y, dirty.w, dirty.h,
+      GL_ALPHA, GL_UNSIGNED_BYTE, texture + dirty.y * TEX_WIDTH + dirty.x);
+  }
+
   glViewport(0, 0, width, height);
   glMatrixMode(GL_PROJECTION);
   glPushMatrix();
@@ -84,10 +140,10 @@ static void push_quad(mu_Rect dst, mu_Rect src, mu_Color color) {
   buf_idx++;
 
   /* update texture buffer */
-  float x = src.x / (float) ATLAS_WIDTH;
-  float y = src.y / (float) ATLAS_HEIGHT;
-  float w = src.w / (float) ATLAS_WIDTH;
-  float h = src.h / (float) ATLAS_HEIGHT;
+  float x = src.x / (float) TEX_WIDTH;
+  float y = src.y / (float) TEX_HEIGHT;
+  float w = src.w / (float) TEX_WIDTH;
+  float h = src.h / (float) TEX_HEIGHT;
   tex_buf[texvert_idx + 0] = x;
   tex_buf[texvert_idx + 1] = y;
   tex_buf[texvert_idx + 2] = x + w;
@@ -128,15 +184,34 @@ void r_draw_rect(mu_Rect rect, mu_Color color) {
 }
 
 
-void r_draw_text(const char *text, mu_Vec2 pos, mu_Color color) {
+void r_draw_box(mu_Rect rect, mu_Color color) {
+  mu_Rect src = atlas[ATLAS_WHITE];
+  push_quad(mu_rect(rect.x + 1, rect.y, rect.w - 2, 1), src, color);
+  push_quad(mu_rect(rect.x + 1, rect.y + rect.h - 1, rect.w - 2, 1), src, color);
+  push_quad(mu_rect(rect.x, rect.y, 1, rect.h), src, color);
+  push_quad(mu_rect(rect.x + rect.w - 1, rect.y, 1, rect.h), src, color);
+}
+
+
+/* `font` is a gc_Font, which may share this renderer's glyph cache (see
+** r_get_font()); NULL draws with the renderer's own font */
+static gc_Font* get_font(mu_Font font) {
+  return font ? font : &default_font;
+}
+
+
+void r_draw_text(mu_Font font, const char *text, mu_Vec2 pos, mu_Color color) {
+  gc_Font *f = get_font(font);
   mu_Rect dst = { pos.x, pos.y, 0, 0 };
-  for (const char *p = text; *p; p++) {
-    if ((*p & 0xc0) == 0x80) { continue; }
-    int chr = mu_min((unsigned char) *p, 127);
-    mu_Rect src = atlas[ATLAS_FONT + chr];
-    dst.w = src.w;
-    dst.h = src.h;
-    push_quad(dst, src, color);
+  unsigned codepoint;
+  int n;
+  while ((n = gc_decode_utf8(text, -1, &codepoint)) > 0) {
+    const gc_Glyph *g = gc_get_glyph(f, codepoint);
+    text += n;
+    if (!g) { continue; }
+    dst.w = g->rect.w;
+    dst.h = g->rect.h;
+    push_quad(dst, g->rect, color);
     dst.x += dst.w;
   }
 }
@@ -150,19 +225,18 @@ void r_draw_icon(int id, mu_Rect rect, mu_Color color) {
 }
 
 
-int r_get_text_width(const char *text, int len) {
-  int res = 0;
-  for (const char *p = text; *p && len--; p++) {
-    if ((*p & 0xc0) == 0x80) { continue; }
-    int chr = mu_min((unsigned char) *p, 127);
-    res += atlas[ATLAS_FONT + chr].w;
-  }
-  return res;
+int r_get_text_width(mu_Font font, const char *text, int len) {
+  return gc_text_width(get_font(font), text, len);
+}
+
+
+int r_get_text_height(mu_Font font) {
+  return get_font(font)->height;
 }
 
 
-int r_get_text_height(void) {
-  return 18;
+mu_Font r_get_font(void) {
+  return &default_font;
 }
 
 
@@ -181,5 +255,6 @@ void r_clear(mu_Color clr) {
 
 void r_present(void) {
   flush();
+  gc_next_frame(&glyph_cache);
   SDL_GL_SwapWindow(window);
 }
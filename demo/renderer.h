@@ -5,13 +5,20 @@
 
 void r_init(void);
 void r_draw_rect(mu_Rect rect, mu_Color color);
-void r_draw_text(const char *text, mu_Vec2 pos, mu_Color color);
+void r_draw_box(mu_Rect rect, mu_Color color);
+void r_draw_text(mu_Font font, const char *text, mu_Vec2 pos, mu_Color color);
 void r_draw_icon(int id, mu_Rect rect, mu_Color color);
- int r_get_text_width(const char *text, int len);
- int r_get_text_height(void);
+ int r_get_text_width(mu_Font font, const char *text, int len);
+ int r_get_text_height(mu_Font font);
+mu_Font r_get_font(void);
 void r_set_clip_rect(mu_Rect rect);
 void r_clear(mu_Color color);
 void r_present(void);
+#ifdef R_HEADLESS
+/* renderer_gl3.c built with R_HEADLESS: copies the frame's 800x600 RGBA
+** pixels to `dst`, top row first */
+void r_read_pixels(unsigned char *dst);
+#endif
 
 #endif
 
@@ -0,0 +1,606 @@
+/*
+** OpenGL 3.3 core / OpenGL ES 3.0 implementation of renderer.h.
+**
+** Vertices are written straight into mapped buffer memory: when
+** ARB_buffer_storage is available a single persistently mapped buffer is
+** split into RING_SIZE segments guarded by fences, otherwise the buffer is
+** orphaned and re-mapped for every flush. Clip rects do not cause a flush;
+** instead each flush issues one draw call per run of quads sharing a
+** scissor rect.
+**
+** Define R_VERTEX_CLIP to give every vertex its quad's clip rect instead;
+** fragments outside it are discarded by the shader, so no scissor state is
+** needed and each flush is a single draw call.
+**
+** Define R_GLES to build against <GLES3/gl3.h>.
+**
+** Define R_HEADLESS to render without a window: the context comes from
+** Mesa's surfaceless EGL platform and frames are drawn into a framebuffer
+** object, read back with r_read_pixels() (see glcompare.c).
+*/
+
+#ifdef R_HEADLESS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <stdlib.h>
+#else
+#include <SDL2/SDL.h>
+#endif
+#ifdef R_GLES
+#include <GLES3/gl3.h>
+#elif defined(R_HEADLESS)
+#define GL_GLEXT_PROTOTYPES 1
+#include <GL/gl.h>
+#include <GL/glext.h>
+#else
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL2/SDL_opengl.h>
+#endif
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "renderer.h"
+#include "glyphcache.h"
+#include "atlas.inl"
+
+#define BUFFER_SIZE 16384
+#define RING_SIZE   3
+#define BATCH_SIZE  1024
+
+/* atlas.inl is copied to the top of the texture, glyphs are cached below */
+enum { TEX_WIDTH = 256, TEX_HEIGHT = ATLAS_HEIGHT + 6 * GC_PAGE_HEIGHT };
+
+#ifdef R_VERTEX_CLIP
+typedef struct { GLfloat x, y, u, v; GLubyte color[4]; GLshort clip[4]; } Vertex;
+#else
+typedef struct { GLfloat x, y, u, v; GLubyte color[4]; } Vertex;
+typedef struct { mu_Rect clip; int first, count; } Batch;
+#endif
+
+static int width  = 800;
+static int height = 600;
+
+#ifndef R_HEADLESS
+static SDL_Window *window;
+#endif
+static GLuint program, vao, vbo, ibo, texture;
+
+static Vertex *verts;     /* mapped memory of the current segment */
+static int buf_idx;       /* quads written to the current segment */
+static int segment;       /* current ring segment */
+static int persistent;    /* using a persistently mapped buffer */
+static Vertex *mapping;   /* base of the persistent mapping */
+static GLsync fences[RING_SIZE];
+
+#ifndef R_VERTEX_CLIP
+static Batch batches[BATCH_SIZE];
+static int batch_idx;
+#endif
+static mu_Rect clip_rect;
+
+static unsigned char pixels[TEX_WIDTH * TEX_HEIGHT];
+static gc_Cache glyph_cache;
+static gc_Font default_font;  /* used for text whose mu_Font is NULL */
+
+
+/* glyph source for the demo font: the ASCII glyphs of atlas.inl, with an
+** empty box standing in for every other codepoint */
+static const unsigned char* atlas_glyph(void *udata, unsigned codepoint,
+  int *w, int *h, int *pitch)
+{
+  static unsigned char tofu[7 * 17];
+  if (codepoint < 32 || codepoint > 127) {
+    if (!tofu[3 * 7 + 1]) {
+      for (int y = 3; y < 14; y++) {
+        for (int x = 1; x < 6; x++) {
+          tofu[y * 7 + x] = (y == 3 || y == 13 || x == 1 || x == 5) ? 255 : 0;
+        }
+      }
+    }
+    *w = 7; *h = 17; *pitch = 7;
+    return tofu;
+  }
+  mu_Rect src = atlas[ATLAS_FONT + codepoint];
+  *w = src.w; *h = src.h; *pitch = ATLAS_WIDTH;
+  return atlas_texture + src.y * ATLAS_WIDTH + src.x;
+}
+
+
+static void flush(void);
+
+static void flush_glyphs(void *udata) {
+  flush();
+}
+
+
+static GLuint compile_shader(GLenum type, const char *header, const char *src) {
+  const char *srcs[] = { header, src };
+  GLint ok;
+  GLuint id = glCreateShader(type);
+  glShaderSource(id, 2, srcs, NULL);
+  glCompileShader(id);
+  glGetShaderiv(id, GL_COMPILE_STATUS, &ok);
+  if (!ok) {
+    char log[512];
+    glGetShaderInfoLog(id, sizeof(log), NULL, log);
+    fprintf(stderr, "shader error: %s\n", log);
+    assert(0);
+  }
+  return id;
+}
+
+
+static int has_buffer_storage(void) {
+#ifdef R_GLES
+  return 0;
+#else
+  GLint i, n, major, minor;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  if (major > 4 || (major == 4 && minor >= 4)) { return 1; }
+  glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+  for (i = 0; i < n; i++) {
+    const char *ext = (const char*) glGetStringi(GL_EXTENSIONS, i);
+    if (!strcmp(ext, "GL_ARB_buffer_storage")) { return 1; }
+  }
+  return 0;
+#endif
+}
+
+
+static void init_program(void) {
+#ifdef R_VERTEX_CLIP
+  static const char *vert_src =
+    "uniform vec2 u_scale;\n"
+    "in vec2 a_pos;\n"
+    "in vec2 a_uv;\n"
+    "in vec4 a_color;\n"
+    "in vec4 a_clip;\n"
+    "out vec2 v_uv;\n"
+    "out vec4 v_color;\n"
+    "flat out vec4 v_clip;\n"
+    "void main() {\n"
+    "  v_uv = a_uv;\n"
+    "  v_color = a_color;\n"
+    "  v_clip = vec4(a_clip.xy, a_clip.xy + a_clip.zw);\n"
+    "  gl_Position = vec4(a_pos * u_scale + vec2(-1.0, 1.0), 0.0, 1.0);\n"
+    "}\n";
+  static const char *frag_src =
+    "uniform sampler2D u_tex;\n"
+    "uniform float u_height;\n"
+    "in vec2 v_uv;\n"
+    "in vec4 v_color;\n"
+    "flat in vec4 v_clip;\n"
+    "out vec4 o_color;\n"
+    "void main() {\n"
+    "  vec2 p = vec2(gl_FragCoord.x, u_height - gl_FragCoord.y);\n"
+    "  if (any(lessThan(p, v_clip.xy)) || any(greaterThanEqual(p, v_clip.zw))) { discard; }\n"
+    "  o_color = vec4(v_color.rgb, v_color.a * texture(u_tex, v_uv).r);\n"
+    "}\n";
+#else
+  static const char *vert_src =
+    "uniform vec2 u_scale;\n"
+    "in vec2 a_pos;\n"
+    "in vec2 a_uv;\n"
+    "in vec4 a_color;\n"
+    "out vec2 v_uv;\n"
+    "out vec4 v_color;\n"
+    "void main() {\n"
+    "  v_uv = a_uv;\n"
+    "  v_color = a_color;\n"
+    "  gl_Position = vec4(a_pos * u_scale + vec2(-1.0, 1.0), 0.0, 1.0);\n"
+    "}\n";
+  static const char *frag_src =
+    "uniform sampler2D u_tex;\n"
+    "in vec2 v_uv;\n"
+    "in vec4 v_color;\n"
+    "out vec4 o_color;\n"
+    "void main() {\n"
+    "  o_color = vec4(v_color.rgb, v_color.a * texture(u_tex, v_uv).r);\n"
+    "}\n";
+#endif
+  const char *version = (const char*) glGetString(GL_VERSION);
+  const char *header = strstr(version, "OpenGL ES")
+    ? "#version 300 es\nprecision mediump float;\n"
+    : "#version 330 core\n";
+  GLint ok;
+
+  program = glCreateProgram();
+  glAttachShader(program, compile_shader(GL_VERTEX_SHADER, header, vert_src));
+  glAttachShader(program, compile_shader(GL_FRAGMENT_SHADER, header, frag_src));
+  glBindAttribLocation(program, 0, "a_pos");
+  glBindAttribLocation(program, 1, "a_uv");
+  glBindAttribLocation(program, 2, "a_color");
+#ifdef R_VERTEX_CLIP
+  glBindAttribLocation(program, 3, "a_clip");
+#endif
+  glLinkProgram(program);
+  glGetProgramiv(program, GL_LINK_STATUS, &ok);
+  assert(ok);
+
+  glUseProgram(program);
+  glUniform1i(glGetUniformLocation(program, "u_tex"), 0);
+  glUniform2f(glGetUniformLocation(program, "u_scale"), 2.0f / width, -2.0f / height);
+#ifdef R_VERTEX_CLIP
+  glUniform1f(glGetUniformLocation(program, "u_height"), height);
+#endif
+}
+
+
+static void init_buffers(void) {
+  static GLushort indices[BUFFER_SIZE * 6];
+  GLsizeiptr size = (GLsizeiptr) sizeof(Vertex) * BUFFER_SIZE * 4;
+  int i;
+
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+
+  /* the index pattern is the same for every quad so it is uploaded once */
+  for (i = 0; i < BUFFER_SIZE; i++) {
+    indices[i * 6 + 0] = i * 4 + 0;
+    indices[i * 6 + 1] = i * 4 + 1;
+    indices[i * 6 + 2] = i * 4 + 2;
+    indices[i * 6 + 3] = i * 4 + 2;
+    indices[i * 6 + 4] = i * 4 + 3;
+    indices[i * 6 + 5] = i * 4 + 1;
+  }
+  glGenBuffers(1, &ibo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  persistent = has_buffer_storage();
+#ifndef R_GLES
+  if (persistent) {
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_ARRAY_BUFFER, size * RING_SIZE, NULL, flags);
+    mapping = glMapBufferRange(GL_ARRAY_BUFFER, 0, size * RING_SIZE, flags);
+    assert(mapping);
+  }
+#endif
+  if (!persistent) {
+    glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+  }
+
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+  glEnableVertexAttribArray(2);
+#ifdef R_VERTEX_CLIP
+  glEnableVertexAttribArray(3);
+#endif
+}
+
+
+#ifdef R_HEADLESS
+static void fail(const char *what) {
+  fprintf(stderr, "renderer: %s failed (EGL error 0x%x)\n", what, eglGetError());
+  exit(EXIT_FAILURE);
+}
+
+
+/* makes a surfaceless context current, drawing into a framebuffer object */
+static void init_headless(void) {
+  PFNEGLGETPLATFORMDISPLAYEXTPROC get_display =
+    (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+#ifdef R_GLES
+  EGLint config_attribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT, EGL_NONE };
+  EGLint context_attribs[] = { EGL_CONTEXT_MAJOR_VERSION, 3, EGL_NONE };
+  EGLenum api = EGL_OPENGL_ES_API;
+#else
+  EGLint config_attribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+  EGLint context_attribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE };
+  EGLenum api = EGL_OPENGL_API;
+#endif
+  EGLDisplay display;
+  EGLConfig config;
+  EGLContext context;
+  EGLint count;
+  GLuint fbo, rbo;
+
+  if (!get_display) { fail("eglGetPlatformDisplayEXT"); }
+  display = get_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+  if (!eglInitialize(display, NULL, NULL)) { fail("eglInitialize"); }
+  /* surfaceless displays may have no configs; nothing is drawn to an EGL
+  ** surface, so a context without one (EGL_KHR_no_config_context) will do */
+  if (!eglChooseConfig(display, config_attribs, &config, 1, &count)) {
+    fail("eglChooseConfig");
+  }
+  if (count == 0) { config = EGL_NO_CONFIG_KHR; }
+  eglBindAPI(api);
+  context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+  if (context == EGL_NO_CONTEXT) { fail("eglCreateContext"); }
+  if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+    fail("eglMakeCurrent");
+  }
+
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glGenRenderbuffers(1, &rbo);
+  glBindRenderbuffer(GL_RENDERBUFFER, rbo);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rbo);
+  assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+}
+#endif
+
+
+void r_init(void) {
+#ifdef R_HEADLESS
+  init_headless();
+#else
+  /* init SDL window */
+#ifdef R_GLES
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
+#else
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+#endif
+  window = SDL_CreateWindow(
+    NULL, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+    width, height, SDL_WINDOW_OPENGL);
+  SDL_GL_CreateContext(window);
+#endif
+
+  /* init gl */
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glDisable(GL_CULL_FACE);
+  glDisable(GL_DEPTH_TEST);
+  glEnable(GL_SCISSOR_TEST);
+  glViewport(0, 0, width, height);
+  init_program();
+  init_buffers();
+
+  /* init texture and glyph cache */
+  for (int y = 0; y < ATLAS_HEIGHT; y++) {
+    memcpy(pixels + y * TEX_WIDTH, atlas_texture + y * ATLAS_WIDTH, ATLAS_WIDTH);
+  }
+  gc_init(&glyph_cache, pixels, TEX_WIDTH, TEX_HEIGHT, ATLAS_HEIGHT);
+  glyph_cache.flush = flush_glyphs;
+  default_font.cache = &glyph_cache;
+  default_font.glyph = atlas_glyph;
+  default_font.height = 18;
+
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, TEX_WIDTH);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, TEX_WIDTH, TEX_HEIGHT, 0,
+    GL_RED, GL_UNSIGNED_BYTE, pixels);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  assert(glGetError() == 0);
+
+  clip_rect = mu_rect(0, 0, width, height);
+}
+
+
+static void map_segment(void) {
+  GLsizeiptr size = (GLsizeiptr) sizeof(Vertex) * BUFFER_SIZE * 4;
+  if (persistent) {
+    /* wait until the gpu has finished reading this segment's last use */
+    if (fences[segment]) {
+      glClientWaitSync(fences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, (GLuint64) -1);
+      glDeleteSync(fences[segment]);
+      fences[segment] = 0;
+    }
+    verts = mapping + segment * BUFFER_SIZE * 4;
+  } else {
+    /* orphan the previous storage so the driver never has to stall */
+    glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+    verts = glMapBufferRange(GL_ARRAY_BUFFER, 0, size,
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    assert(verts);
+  }
+}
+
+
+static void flush(void) {
+#ifndef R_VERTEX_CLIP
+  int i;
+#endif
+  GLintptr base;
+  mu_Rect dirty;
+  if (buf_idx == 0) { return; }
+
+  /* upload glyphs added since the last draw */
+  if (gc_get_dirty(&glyph_cache, &dirty)) {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, dirty.x, dirty.y, dirty.w, dirty.h,
+      GL_RED, GL_UNSIGNED_BYTE, pixels + dirty.y * TEX_WIDTH + dirty.x);
+  }
+
+  base = persistent ? (GLintptr) sizeof(Vertex) * segment * BUFFER_SIZE * 4 : 0;
+  if (!persistent) { glUnmapBuffer(GL_ARRAY_BUFFER); }
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+    (void*) (base + offsetof(Vertex, x)));
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+    (void*) (base + offsetof(Vertex, u)));
+  glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex),
+    (void*) (base + offsetof(Vertex, color)));
+
+#ifdef R_VERTEX_CLIP
+  glVertexAttribPointer(3, 4, GL_SHORT, GL_FALSE, sizeof(Vertex),
+    (void*) (base + offsetof(Vertex, clip)));
+  glDrawElements(GL_TRIANGLES, buf_idx * 6, GL_UNSIGNED_SHORT, NULL);
+#else
+  /* one draw call per run of quads sharing a scissor rect */
+  for (i = 0; i < batch_idx; i++) {
+    Batch *b = &batches[i];
+    if (b->count == 0) { continue; }
+    glScissor(b->clip.x, height - (b->clip.y + b->clip.h), b->clip.w, b->clip.h);
+    glDrawElements(GL_TRIANGLES, b->count * 6, GL_UNSIGNED_SHORT,
+      (void*) (b->first * 6 * sizeof(GLushort)));
+  }
+  batch_idx = 0;
+#endif
+
+  if (persistent) {
+    fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    segment = (segment + 1) % RING_SIZE;
+  }
+  verts = NULL;
+  buf_idx = 0;
+}
+
+
+#ifndef R_VERTEX_CLIP
+static Batch* current_batch(void) {
+  if (batch_idx == 0) {
+    batches[batch_idx++] = (Batch) { clip_rect, buf_idx, 0 };
+  }
+  return &batches[batch_idx - 1];
+}
+#endif
+
+
+static void push_quad(mu_Rect dst, mu_Rect src, mu_Color color) {
+  Vertex *v;
+  float x, y, w, h;
+  if (buf_idx == BUFFER_SIZE) { flush(); }
+  if (!verts) { map_segment(); }
+#ifndef R_VERTEX_CLIP
+  current_batch()->count++;
+#endif
+
+  v = verts + buf_idx * 4;
+  buf_idx++;
+
+  x = src.x / (float) TEX_WIDTH;
+  y = src.y / (float) TEX_HEIGHT;
+  w = src.w / (float) TEX_WIDTH;
+  h = src.h / (float) TEX_HEIGHT;
+  v[0] = (Vertex) { dst.x,         dst.y,         x,     y,     { color.r, color.g, color.b, color.a } };
+  v[1] = (Vertex) { dst.x + dst.w, dst.y,         x + w, y,     { color.r, color.g, color.b, color.a } };
+  v[2] = (Vertex) { dst.x,         dst.y + dst.h, x,     y + h, { color.r, color.g, color.b, color.a } };
+  v[3] = (Vertex) { dst.x + dst.w, dst.y + dst.h, x + w, y + h, { color.r, color.g, color.b, color.a } };
+#ifdef R_VERTEX_CLIP
+  for (int i = 0; i < 4; i++) {
+    v[i].clip[0] = clip_rect.x;
+    v[i].clip[1] = clip_rect.y;
+    v[i].clip[2] = clip_rect.w;
+    v[i].clip[3] = clip_rect.h;
+  }
+#endif
+}
+
+
+void r_draw_rect(mu_Rect rect, mu_Color color) {
+  push_quad(rect, atlas[ATLAS_WHITE], color);
+}
+
+
+void r_draw_box(mu_Rect rect, mu_Color color) {
+  mu_Rect src = atlas[ATLAS_WHITE];
+  push_quad(mu_rect(rect.x + 1, rect.y, rect.w - 2, 1), src, color);
+  push_quad(mu_rect(rect.x + 1, rect.y + rect.h - 1, rect.w - 2, 1), src, color);
+  push_quad(mu_rect(rect.x, rect.y, 1, rect.h), src, color);
+  push_quad(mu_rect(rect.x + rect.w - 1, rect.y, 1, rect.h), src, color);
+}
+
+
+/* `font` is a gc_Font, which may share this renderer's glyph cache (see
+** r_get_font()); NULL draws with the renderer's own font */
+static gc_Font* get_font(mu_Font font) {
+  return font ? font : &default_font;
+}
+
+
+void r_draw_text(mu_Font font, const char *text, mu_Vec2 pos, mu_Color color) {
+  gc_Font *f = get_font(font);
+  mu_Rect dst = { pos.x, pos.y, 0, 0 };
+  unsigned codepoint;
+  int n;
+  while ((n = gc_decode_utf8(text, -1, &codepoint)) > 0) {
+    const gc_Glyph *g = gc_get_glyph(f, codepoint);
+    text += n;
+    if (!g) { continue; }
+    dst.w = g->rect.w;
+    dst.h = g->rect.h;
+    push_quad(dst, g->rect, color);
+    dst.x += dst.w;
+  }
+}
+
+
+void r_draw_icon(int id, mu_Rect rect, mu_Color color) {
+  mu_Rect src = atlas[id];
+  int x = rect.x + (rect.w - src.w) / 2;
+  int y = rect.y + (rect.h - src.h) / 2;
+  push_quad(mu_rect(x, y, src.w, src.h), src, color);
+}
+
+
+int r_get_text_width(mu_Font font, const char *text, int len) {
+  return gc_text_width(get_font(font), text, len);
+}
+
+
+int r_get_text_height(mu_Font font) {
+  return get_font(font)->height;
+}
+
+
+mu_Font r_get_font(void) {
+  return &default_font;
+}
+
+
+void r_set_clip_rect(mu_Rect rect) {
+#ifdef R_VERTEX_CLIP
+  /* clamped to the screen so the rect fits in the vertex's shorts */
+  int x1 = mu_max(rect.x, 0), y1 = mu_max(rect.y, 0);
+  int x2 = mu_min(rect.x + rect.w, width), y2 = mu_min(rect.y + rect.h, height);
+  clip_rect = mu_rect(x1, y1, mu_max(x2 - x1, 0), mu_max(y2 - y1, 0));
+#else
+  Batch *b;
+  clip_rect = rect;
+  if (batch_idx == 0) { return; }
+  b = &batches[batch_idx - 1];
+  /* reuse the open batch if nothing was drawn with its rect yet */
+  if (b->count == 0) { b->clip = rect; return; }
+  if (batch_idx == BATCH_SIZE) { flush(); return; }
+  batches[batch_idx++] = (Batch) { rect, buf_idx, 0 };
+#endif
+}
+
+
+void r_clear(mu_Color clr) {
+  flush();
+  glScissor(0, 0, width, height);
+  glClearColor(clr.r / 255., clr.g / 255., clr.b / 255., clr.a / 255.);
+  glClear(GL_COLOR_BUFFER_BIT);
+}
+
+
+void r_present(void) {
+  flush();
+  gc_next_frame(&glyph_cache);
+#ifndef R_HEADLESS
+  SDL_GL_SwapWindow(window);
+#endif
+}
+
+
+#ifdef R_HEADLESS
+void r_read_pixels(unsigned char *dst) {
+  int y;
+  flush();
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, dst);
+  /* flip to top-down rows */
+  for (y = 0; y < height / 2; y++) {
+    unsigned char *a = dst + y * width * 4, *b = dst + (height - 1 - y) * width * 4;
+    for (int x = 0; x < width * 4; x++) {
+      unsigned char t = a[x]; a[x] = b[x]; b[x] = t;
+    }
+  }
+}
+#endif
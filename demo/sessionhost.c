@@ -0,0 +1,263 @@
+/*
+** Session host: many lightweight contexts in one process, e.g. one per
+** remote client. Each session is a single allocation holding its context,
+** command list and segment arena; callbacks are shared and each session
+** gets its own copy of the style, which style overrides write to. Posting
+** input to a session puts it in the context's inbox (mu_post_event()) and
+** queues the session on the host's run queue, and a pool of worker threads
+** builds frames only for queued sessions. A session stays queued while
+** mu_end() reports that another frame is needed, so it settles after its
+** input and then costs nothing. Each built frame is linearized into the
+** session's output buffer, ready to be sent.
+**
+** Each session has its own posting lock, making the posting threads its
+** inbox's single producer, so posts to different sessions never contend. The
+** host's mutex guards the run queue and is only taken by a post that finds
+** its session not queued; it is never held while a frame is built. A post
+** sets `posted` before reading `queued`, and a worker clears `queued` before
+** reading `posted`, so input arriving while its session's frame is built is
+** never left without a frame.
+*/
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sessionhost.h"
+
+#define MAX_THREADS 64
+
+struct sh_Session {
+  mu_Context ctx;
+  sh_FrameFn frame;
+  void *udata;
+  sh_Session *next;   /* run queue link */
+  atomic_int queued;  /* on the run queue or being built; written under the host's mutex */
+  int closing;        /* sh_close() is waiting for the frame being built */
+  atomic_int posted;  /* input was posted since the frame being built began */
+  pthread_mutex_t post_lock;
+  /* last frame, linearized; -1 if it didn't fit */
+  char *output;
+  int output_len;
+  mu_ContextStorage cold;  /* stacks and pools of `ctx` */
+};
+
+struct sh_Host {
+  sh_Config cfg;
+  const mu_Style *style;  /* `cfg.style` or `default_style`, copied by sh_open() */
+  mu_Style default_style;
+  pthread_t threads[MAX_THREADS];
+  int thread_count;
+  pthread_mutex_t mutex;
+  pthread_cond_t work, idle;
+  int quit;
+  sh_Session *head, *tail;
+  int pending;        /* sessions queued or being built */
+  long frames, overflows;
+  atomic_long events, dropped;
+};
+
+
+static int align(int n) {
+  return (n + 15) & ~15;
+}
+
+
+/* callers hold the host's mutex */
+static void enqueue(sh_Host *host, sh_Session *s) {
+  if (s->queued) { return; }
+  s->queued = 1;
+  s->next = NULL;
+  if (host->tail) { host->tail->next = s; } else { host->head = s; }
+  host->tail = s;
+  host->pending++;
+  pthread_cond_signal(&host->work);
+}
+
+
+static void build_frame(sh_Host *host, sh_Session *s) {
+  int more;
+
+  /* input posted from here on is left for the next frame */
+  atomic_store(&s->posted, 0);
+
+  mu_begin(&s->ctx);
+  s->frame(&s->ctx, s->udata);
+  more = mu_end(&s->ctx);
+  s->output_len = mu_linearize(&s->ctx, s->output, host->cfg.output_size);
+  /* mu_linearize() returns 0 when the frame doesn't fit; a frame always has
+  ** at least the commands of its roots, so 0 is never a valid length */
+  if (s->output_len == 0) { s->output_len = -1; }
+
+  pthread_mutex_lock(&host->mutex);
+  host->frames++;
+  if (s->output_len < 0) { host->overflows++; }
+  s->queued = 0;
+  host->pending--;
+  if ((more || atomic_load(&s->posted)) && !s->closing) { enqueue(host, s); }
+  if (host->pending == 0 || s->closing) { pthread_cond_broadcast(&host->idle); }
+  pthread_mutex_unlock(&host->mutex);
+}
+
+
+static void* worker(void *udata) {
+  sh_Host *host = udata;
+  for (;;) {
+    sh_Session *s;
+    pthread_mutex_lock(&host->mutex);
+    while (!host->head && !host->quit) {
+      pthread_cond_wait(&host->work, &host->mutex);
+    }
+    if (host->quit) { pthread_mutex_unlock(&host->mutex); return NULL; }
+    s = host->head;
+    host->head = s->next;
+    if (!host->head) { host->tail = NULL; }
+    pthread_mutex_unlock(&host->mutex);
+    build_frame(host, s);
+  }
+}
+
+
+sh_Host* sh_create(const sh_Config *cfg) {
+  int i;
+  sh_Host *host = calloc(1, sizeof(sh_Host));
+  if (!host) { abort(); }
+  host->cfg = *cfg;
+  host->style = cfg->style;
+  if (!host->style) {
+    /* take the library's default from a throwaway context */
+    sh_Session *tmp = calloc(1, sizeof(sh_Session));
+    if (!tmp) { abort(); }
+    mu_init_ex(&tmp->ctx, &tmp->cold, NULL, 0, NULL, 0);
+    host->default_style = *tmp->ctx.style;
+    host->style = &host->default_style;
+    free(tmp);
+  }
+  pthread_mutex_init(&host->mutex, NULL);
+  pthread_cond_init(&host->work, NULL);
+  pthread_cond_init(&host->idle, NULL);
+  host->thread_count = mu_clamp(cfg->threads, 1, MAX_THREADS);
+  for (i = 0; i < host->thread_count; i++) {
+    pthread_create(&host->threads[i], NULL, worker, host);
+  }
+  return host;
+}
+
+
+void sh_destroy(sh_Host *host) {
+  int i;
+  pthread_mutex_lock(&host->mutex);
+  host->quit = 1;
+  pthread_cond_broadcast(&host->work);
+  pthread_mutex_unlock(&host->mutex);
+  for (i = 0; i < host->thread_count; i++) {
+    pthread_join(host->threads[i], NULL);
+  }
+  pthread_mutex_destroy(&host->mutex);
+  pthread_cond_destroy(&host->work);
+  pthread_cond_destroy(&host->idle);
+  free(host);
+}
+
+
+sh_Session* sh_open(sh_Host *host, sh_FrameFn frame, void *udata) {
+  sh_Config *cfg = &host->cfg;
+  int base = align(sizeof(sh_Session));
+  int commands = align(cfg->command_size);
+  int segments = align(cfg->segment_size);
+  char *mem = malloc(base + commands + segments + cfg->output_size);
+  sh_Session *s = (sh_Session*) mem;
+  if (!mem) { abort(); }
+  mu_init_ex(&s->ctx, &s->cold, mem + base, cfg->command_size,
+    mem + base + commands, cfg->segment_size);
+  s->ctx.text_width = cfg->text_width;
+  s->ctx.text_height = cfg->text_height;
+  s->ctx.mode = cfg->mode;
+  s->ctx._style = *host->style;
+  s->frame = frame;
+  s->udata = udata;
+  s->next = NULL;
+  atomic_init(&s->queued, 0);
+  s->closing = 0;
+  atomic_init(&s->posted, 0);
+  pthread_mutex_init(&s->post_lock, NULL);
+  s->output = mem + base + commands + segments;
+  s->output_len = 0;
+  /* build a first frame so the session has output */
+  pthread_mutex_lock(&host->mutex);
+  enqueue(host, s);
+  pthread_mutex_unlock(&host->mutex);
+  return s;
+}
+
+
+void sh_close(sh_Host *host, sh_Session *s) {
+  pthread_mutex_lock(&host->mutex);
+  if (s->queued) {
+    /* unlink it if it is still waiting, otherwise wait for its frame */
+    sh_Session **p = &host->head, *prev = NULL;
+    while (*p && *p != s) { prev = *p; p = &(*p)->next; }
+    if (*p) {
+      *p = s->next;
+      if (host->tail == s) { host->tail = prev; }
+      s->queued = 0;
+      if (--host->pending == 0) { pthread_cond_broadcast(&host->idle); }
+    }
+    s->closing = 1;
+    while (s->queued) { pthread_cond_wait(&host->idle, &host->mutex); }
+  }
+  pthread_mutex_unlock(&host->mutex);
+  pthread_mutex_destroy(&s->post_lock);
+  free(s);
+}
+
+
+/* safe to call from any thread; events which do not fit are dropped */
+void sh_post(sh_Host *host, sh_Session *s, const mu_Event *ev) {
+  int ok;
+  pthread_mutex_lock(&s->post_lock);
+  ok = mu_post_event(&s->ctx, ev);
+  pthread_mutex_unlock(&s->post_lock);
+  if (!ok) { atomic_fetch_add(&host->dropped, 1); return; }
+  atomic_fetch_add(&host->events, 1);
+  atomic_store(&s->posted, 1);
+  if (!atomic_load(&s->queued)) {
+    pthread_mutex_lock(&host->mutex);
+    enqueue(host, s);
+    pthread_mutex_unlock(&host->mutex);
+  }
+}
+
+
+/* waits until no session has a frame queued */
+void sh_wait(sh_Host *host) {
+  pthread_mutex_lock(&host->mutex);
+  while (host->pending > 0) { pthread_cond_wait(&host->idle, &host->mutex); }
+  pthread_mutex_unlock(&host->mutex);
+}
+
+
+void sh_get_stats(sh_Host *host, sh_Stats *stats) {
+  pthread_mutex_lock(&host->mutex);
+  stats->frames = host->frames;
+  stats->overflows = host->overflows;
+  pthread_mutex_unlock(&host->mutex);
+  stats->events = atomic_load(&host->events);
+  stats->dropped = atomic_load(&host->dropped);
+}
+
+
+/* the session's last frame as written by mu_linearize(), or -1 if it didn't
+** fit in `output_size` bytes; only stable while the session is not queued,
+** e.g. after sh_wait() */
+int sh_get_output(sh_Session *s, const char **data) {
+  *data = s->output;
+  return s->output_len;
+}
+
+
+/* bytes allocated per session */
+int sh_session_size(sh_Host *host) {
+  return align(sizeof(sh_Session)) + align(host->cfg.command_size) +
+    align(host->cfg.segment_size) + host->cfg.output_size;
+}
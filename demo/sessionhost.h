@@ -0,0 +1,48 @@
+#ifndef SESSIONHOST_H
+#define SESSIONHOST_H
+
+#include "microui/microui.h"
+
+/* input is passed on through each context's inbox */
+#ifndef MU_INBOX
+#error "the session host needs microui compiled with MU_INBOX defined"
+#endif
+
+typedef struct sh_Host sh_Host;
+typedef struct sh_Session sh_Session;
+
+/* builds one frame's UI; called by a worker thread between mu_begin() and
+** mu_end(), never for the same session on two threads at once */
+typedef void (*sh_FrameFn)(mu_Context *ctx, void *udata);
+
+typedef struct {
+  int threads;
+  int command_size;   /* bytes of command list per session */
+  int segment_size;   /* bytes of segment arena per session */
+  int output_size;    /* bytes kept for the last frame's linearized commands */
+  int mode;           /* mu_Context.mode of every session */
+  /* shared by every session */
+  int (*text_width)(mu_Font font, const char *str, int len);
+  int (*text_height)(mu_Font font);
+  /* copied into every session when opened; the library's default if NULL */
+  const mu_Style *style;
+} sh_Config;
+
+typedef struct {
+  long frames;        /* frames built */
+  long events;        /* input events posted */
+  long dropped;       /* events which did not fit an inbox */
+  long overflows;     /* frames which did not fit an output buffer */
+} sh_Stats;
+
+sh_Host* sh_create(const sh_Config *cfg);
+void sh_destroy(sh_Host *host);
+sh_Session* sh_open(sh_Host *host, sh_FrameFn frame, void *udata);
+void sh_close(sh_Host *host, sh_Session *s);
+void sh_post(sh_Host *host, sh_Session *s, const mu_Event *ev);
+void sh_wait(sh_Host *host);
+void sh_get_stats(sh_Host *host, sh_Stats *stats);
+ int sh_get_output(sh_Session *s, const char **data);
+ int sh_session_size(sh_Host *host);
+
+#endif
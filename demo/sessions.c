@@ -0,0 +1,148 @@
+/*
+** Benchmark for the session host (sessionhost.c): opens many sessions each
+** running its own copy of the demo, then for a number of rounds posts a
+** click or a mouse move to a fraction of them and waits for the pool to
+** build every frame that results. Prints the memory used per session and
+** how many input updates a core handles per second, from which the number
+** of sessions a core can serve at a given update rate follows. All
+** sessions measure text with one shared font (sharedfont.c).
+**
+** usage: ./sessions [sessions] [threads] [rounds] [active %]
+*/
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sessionhost.h"
+#include "sharedfont.h"
+#include "swrender.h"
+#include "microui/demo.h"
+
+#define COMMAND_SIZE  (16 * 1024)
+#define SEGMENT_SIZE  (4 * 1024)
+#define OUTPUT_SIZE   (16 * 1024)
+#define LOG_SIZE      1024
+#define UPDATE_RATE   10  /* input updates per second of a busy session */
+
+typedef struct {
+  mu_DemoState demo;
+  char log[LOG_SIZE];
+} Client;
+
+static sf_Font font;
+
+
+static int text_width(mu_Font f, const char *text, int len) {
+  return sf_text_width(&font, text, len);
+}
+
+
+static int text_height(mu_Font f) {
+  return sf_text_height(&font);
+}
+
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static void frame(mu_Context *ctx, void *udata) {
+  Client *c = udata;
+  mu_demo_ex(ctx, &c->demo);
+}
+
+
+/* every session gets its own path over the windows */
+static void post_input(sh_Host *host, sh_Session *s, int session, int round) {
+  mu_Event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.pos = mu_vec2(60 + (session * 13 + round * 7) % 600, 60 + (session * 5 + round * 3) % 400);
+  ev.type = MU_EVENT_MOUSEMOVE;
+  sh_post(host, s, &ev);
+  if (round % 4 == 1) {
+    ev.key = MU_MOUSE_LEFT;
+    ev.type = MU_EVENT_MOUSEDOWN; sh_post(host, s, &ev);
+    ev.type = MU_EVENT_MOUSEUP;   sh_post(host, s, &ev);
+  }
+}
+
+
+int main(int argc, char **argv) {
+  int count = argc > 1 ? atoi(argv[1]) : 2000;
+  int threads = argc > 2 ? atoi(argv[2]) : 4;
+  int rounds = argc > 3 ? atoi(argv[3]) : 20;
+  int active = argc > 4 ? atoi(argv[4]) : 10;
+  int cores = mu_min(threads, (int) sysconf(_SC_NPROCESSORS_ONLN));
+  int i, r, updates = 0;
+  long frames;
+  double t, elapsed;
+  sh_Stats stats;
+  sh_Config cfg;
+  sh_Host *host;
+  sh_Session **sessions = malloc(count * sizeof(*sessions));
+  Client *clients = malloc(count * sizeof(*clients));
+  if (!sessions || !clients) { abort(); }
+
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.threads = threads;
+  cfg.command_size = COMMAND_SIZE;
+  cfg.segment_size = SEGMENT_SIZE;
+  cfg.output_size = OUTPUT_SIZE;
+  cfg.mode = MU_MODE_BATCH | MU_MODE_LAZYCLIP | MU_MODE_COALESCE;
+  cfg.text_width = text_width;
+  cfg.text_height = text_height;
+  sf_init(&font, sw_get_glyph, NULL, sw_get_text_height(NULL));
+  host = sh_create(&cfg);
+
+  t = now();
+  for (i = 0; i < count; i++) {
+    mu_demo_init(&clients[i].demo, clients[i].log, LOG_SIZE);
+    sessions[i] = sh_open(host, frame, &clients[i]);
+  }
+  sh_wait(host);
+  sf_synchronize(&font);
+  printf("open ms/session: %.3f\n", (now() - t) * 1000 / count);
+  sh_get_stats(host, &stats);
+
+  t = now();
+  for (r = 0; r < rounds; r++) {
+    for (i = 0; i < count; i++) {
+      if ((i + r * 7919) % 100 >= active) { continue; }
+      post_input(host, sessions[i], i, r);
+      updates++;
+    }
+    sh_wait(host);
+    sf_synchronize(&font);
+  }
+  elapsed = now() - t;
+  frames = stats.frames;
+  sh_get_stats(host, &stats);
+  frames = stats.frames - frames;
+
+  printf("sessions: %d\n", count);
+  printf("threads: %d (on %d cores)\n", threads, cores);
+  printf("bytes/session: %d (host %d, demo state %d)\n",
+    sh_session_size(host) + (int) sizeof(Client),
+    sh_session_size(host), (int) sizeof(Client));
+  printf("updates: %d, frames: %ld, frames/update: %.2f\n",
+    updates, frames, (double) frames / updates);
+  printf("us/frame: %.1f\n", elapsed * cores * 1e6 / frames);
+  printf("updates/s/core: %.0f\n", updates / (elapsed * cores));
+  printf("sessions/core at %d updates/s: %.0f\n",
+    UPDATE_RATE, updates / (elapsed * cores) / UPDATE_RATE);
+  if (stats.dropped) { printf("dropped events: %ld\n", stats.dropped); }
+  if (stats.overflows) { printf("frames over OUTPUT_SIZE: %ld\n", stats.overflows); }
+
+  for (i = 0; i < count; i++) { sh_close(host, sessions[i]); }
+  sh_destroy(host);
+  sf_deinit(&font);
+  free(sessions);
+  free(clients);
+  return 0;
+}
@@ -0,0 +1,285 @@
+/*
+** Font shared by any number of contexts and threads. Readers never lock:
+** they load the font's current table, an immutable snapshot mapping
+** codepoints to advances and atlas locations, and use it as is. A reader
+** missing a glyph takes the writer lock, rasterizes every glyph the string
+** is missing into free space of the atlas pages, and publishes a copy of
+** the table with them added (read-copy-update). Published glyph pixels are
+** never written again, as pages are only ever appended to; when they are
+** full new glyphs get no advance and draw nothing.
+**
+** Replaced tables are kept until sf_synchronize(), which the caller runs
+** at a quiescent point, when no thread is inside an sf_*() call (e.g.
+** between frames). Renderers upload the glyphs added since they last
+** looked with sf_next_glyph().
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "sharedfont.h"
+
+struct sf_Table {
+  int count, cap;
+  int mask;           /* slot count - 1 */
+  short ascii[128];   /* advance of each loaded ASCII glyph, -1 if not loaded */
+  sf_Table *next;     /* retired list */
+  sf_Glyph *glyphs;   /* in the order they were added */
+  int *slots;         /* index + 1 into `glyphs`, 0 when empty */
+};
+
+
+static unsigned hash(unsigned codepoint) {
+  return codepoint * 2654435761u;
+}
+
+
+static const sf_Glyph* lookup(sf_Table *t, unsigned codepoint) {
+  int i = hash(codepoint) & t->mask;
+  for (;;) {
+    int n = t->slots[i];
+    if (n == 0) { return NULL; }
+    if (t->glyphs[n - 1].codepoint == codepoint) { return &t->glyphs[n - 1]; }
+    i = (i + 1) & t->mask;
+  }
+}
+
+
+static void insert(sf_Table *t, const sf_Glyph *g) {
+  int i = hash(g->codepoint) & t->mask;
+  while (t->slots[i]) { i = (i + 1) & t->mask; }
+  t->glyphs[t->count++] = *g;
+  t->slots[i] = t->count;
+  if (g->codepoint < 128) { t->ascii[g->codepoint] = g->rect.w; }
+}
+
+
+/* a table with room for `cap` glyphs holding those of `src` */
+static sf_Table* create_table(sf_Table *src, int cap) {
+  sf_Table *t;
+  int i, slots = 16;
+  while (slots < cap * 2) { slots *= 2; }
+  t = malloc(sizeof(sf_Table) + cap * sizeof(sf_Glyph) + slots * sizeof(int));
+  if (!t) { abort(); }
+  t->count = 0;
+  t->cap = cap;
+  t->mask = slots - 1;
+  t->next = NULL;
+  t->glyphs = (sf_Glyph*) (t + 1);
+  t->slots = (int*) (t->glyphs + cap);
+  memset(t->slots, 0, slots * sizeof(int));
+  for (i = 0; i < 128; i++) { t->ascii[i] = -1; }
+  if (src) {
+    for (i = 0; i < src->count; i++) { insert(t, &src->glyphs[i]); }
+  }
+  return t;
+}
+
+
+/* places a w*h rect in `page`, reusing the tightest shelf which fits */
+static int pack(sf_Page *p, int w, int h, mu_Rect *rect) {
+  sf_Shelf *best = NULL;
+  int i;
+  for (i = 0; i < p->shelf_count; i++) {
+    sf_Shelf *s = &p->shelves[i];
+    if (s->h < h || s->x + w > SF_PAGE_SIZE) { continue; }
+    if (!best || s->h < best->h) { best = s; }
+  }
+  if (!best) {
+    if (p->shelf_count == SF_MAX_SHELVES || p->used + h > SF_PAGE_SIZE) { return 0; }
+    best = &p->shelves[p->shelf_count++];
+    best->y = p->used;
+    best->h = h;
+    best->x = 0;
+    p->used += h;
+  }
+  *rect = mu_rect(best->x, best->y, w, h);
+  best->x += w;
+  return 1;
+}
+
+
+/* rasterizes `codepoint` into the first page with room; a glyph which
+** cannot be loaded is kept with an empty rect so it is not retried */
+static void load_glyph(sf_Font *font, unsigned codepoint, sf_Glyph *g) {
+  const unsigned char *src;
+  int i, w, h, pitch;
+  g->codepoint = codepoint;
+  g->page = -1;
+  g->rect = mu_rect(0, 0, 0, 0);
+  src = font->glyph(font->udata, codepoint, &w, &h, &pitch);
+  if (!src || w > SF_PAGE_SIZE || h > SF_PAGE_SIZE) { return; }
+  for (i = 0; i < SF_MAX_PAGES; i++) {
+    sf_Page *p = &font->pages[i];
+    if (i == font->page_count) {
+      p->pixels = calloc(SF_PAGE_SIZE, SF_PAGE_SIZE);
+      if (!p->pixels) { abort(); }
+      font->page_count++;
+    }
+    if (pack(p, w, h, &g->rect)) { g->page = i; break; }
+  }
+  if (g->page < 0) { return; }
+  for (i = 0; i < h; i++) {
+    memcpy(font->pages[g->page].pixels + (g->rect.y + i) * SF_PAGE_SIZE + g->rect.x,
+      src + i * pitch, w);
+  }
+}
+
+
+/* adds every glyph of `text` missing from the current table, returning the
+** table which has them */
+static sf_Table* add_glyphs(sf_Font *font, const char *text, int len) {
+  sf_Table *old, *t;
+  unsigned codepoint;
+  const char *p;
+  int n, l, missing = 0;
+
+  pthread_mutex_lock(&font->lock);
+  old = atomic_load_explicit(&font->table, memory_order_relaxed);
+  for (p = text, l = len; (n = gc_decode_utf8(p, l, &codepoint)) > 0; p += n) {
+    if (!lookup(old, codepoint)) { missing++; }
+    if (l > 0) { l -= n; }
+  }
+  missing = mu_min(missing, SF_MAX_GLYPHS - old->count);
+  if (missing == 0) {
+    /* another thread added them first, or the table is full */
+    pthread_mutex_unlock(&font->lock);
+    return old;
+  }
+
+  t = create_table(old, old->count + missing);
+  for (p = text, l = len; (n = gc_decode_utf8(p, l, &codepoint)) > 0; p += n) {
+    if (t->count < t->cap && !lookup(t, codepoint)) {
+      sf_Glyph g;
+      load_glyph(font, codepoint, &g);
+      insert(t, &g);
+    }
+    if (l > 0) { l -= n; }
+  }
+
+  /* the glyphs' pixels were written above, before the table is published */
+  atomic_store_explicit(&font->table, t, memory_order_release);
+  old->next = font->retired;
+  font->retired = old;
+  pthread_mutex_unlock(&font->lock);
+  return t;
+}
+
+
+void sf_init(sf_Font *font, gc_GlyphFn glyph, void *udata, int height) {
+  memset(font, 0, sizeof(*font));
+  font->glyph = glyph;
+  font->udata = udata;
+  font->height = height;
+  pthread_mutex_init(&font->lock, NULL);
+  atomic_init(&font->table, create_table(NULL, 128));
+}
+
+
+void sf_deinit(sf_Font *font) {
+  int i;
+  sf_synchronize(font);
+  free(atomic_load(&font->table));
+  for (i = 0; i < font->page_count; i++) { free(font->pages[i].pixels); }
+  pthread_mutex_destroy(&font->lock);
+}
+
+
+/* frees the tables replaced since the last call; no thread may be inside
+** an sf_*() call on `font` while this runs */
+void sf_synchronize(sf_Font *font) {
+  sf_Table *t;
+  pthread_mutex_lock(&font->lock);
+  t = font->retired;
+  font->retired = NULL;
+  pthread_mutex_unlock(&font->lock);
+  while (t) {
+    sf_Table *next = t->next;
+    free(t);
+    t = next;
+  }
+}
+
+
+static int encode_utf8(unsigned codepoint, char *buf) {
+  if (codepoint < 0x80) { buf[0] = codepoint; return 1; }
+  if (codepoint < 0x800) {
+    buf[0] = 0xc0 | (codepoint >> 6);
+    buf[1] = 0x80 | (codepoint & 0x3f);
+    return 2;
+  }
+  if (codepoint < 0x10000) {
+    buf[0] = 0xe0 | (codepoint >> 12);
+    buf[1] = 0x80 | ((codepoint >> 6) & 0x3f);
+    buf[2] = 0x80 | (codepoint & 0x3f);
+    return 3;
+  }
+  buf[0] = 0xf0 | (codepoint >> 18);
+  buf[1] = 0x80 | ((codepoint >> 12) & 0x3f);
+  buf[2] = 0x80 | ((codepoint >> 6) & 0x3f);
+  buf[3] = 0x80 | (codepoint & 0x3f);
+  return 4;
+}
+
+
+/* loads the glyph if needed; returns 0 if it has nothing to draw */
+int sf_get_glyph(sf_Font *font, unsigned codepoint, sf_Glyph *g) {
+  sf_Table *t = atomic_load_explicit(&font->table, memory_order_acquire);
+  const sf_Glyph *res = lookup(t, codepoint);
+  if (!res) {
+    char buf[4];
+    t = add_glyphs(font, buf, encode_utf8(codepoint, buf));
+    if (!(res = lookup(t, codepoint))) { return 0; }
+  }
+  *g = *res;
+  return g->page >= 0;
+}
+
+
+/* iterates the loaded glyphs in the order they were added, starting at
+** `*idx`; a renderer keeping `idx` between frames sees each glyph once */
+int sf_next_glyph(sf_Font *font, int *idx, sf_Glyph *g) {
+  sf_Table *t = atomic_load_explicit(&font->table, memory_order_acquire);
+  while (*idx < t->count) {
+    *g = t->glyphs[(*idx)++];
+    if (g->page >= 0) { return 1; }
+  }
+  return 0;
+}
+
+
+/* the page's SF_PAGE_SIZE * SF_PAGE_SIZE coverage bytes; only the rects of
+** glyphs returned by sf_get_glyph() or sf_next_glyph() may be read */
+const unsigned char* sf_get_pixels(sf_Font *font, int page) {
+  return font->pages[page].pixels;
+}
+
+
+int sf_text_width(sf_Font *font, const char *text, int len) {
+  sf_Table *t = atomic_load_explicit(&font->table, memory_order_acquire);
+  int pass;
+  for (pass = 0; pass < 2; pass++) {
+    const char *p = text;
+    unsigned codepoint;
+    int n, l = len, res = 0, missing = 0;
+    while ((n = gc_decode_utf8(p, l, &codepoint)) > 0) {
+      if (codepoint < 128 && t->ascii[codepoint] >= 0) {
+        res += t->ascii[codepoint];
+      } else {
+        const sf_Glyph *g = lookup(t, codepoint);
+        if (g) { res += g->rect.w; } else { missing = 1; }
+      }
+      p += n;
+      if (l > 0) { l -= n; }
+    }
+    /* load what is missing and measure again; anything still missing
+    ** after that did not fit and has no width */
+    if (!missing || pass == 1) { return res; }
+    t = add_glyphs(font, text, len);
+  }
+  return 0;
+}
+
+
+int sf_text_height(sf_Font *font) {
+  return font->height;
+}
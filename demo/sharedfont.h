@@ -0,0 +1,54 @@
+#ifndef SHAREDFONT_H
+#define SHAREDFONT_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "glyphcache.h"
+
+#define SF_MAX_GLYPHS   4096
+#define SF_MAX_PAGES    8
+#define SF_MAX_SHELVES  16
+#define SF_PAGE_SIZE    256
+
+typedef struct {
+  unsigned codepoint;
+  int page;
+  mu_Rect rect;   /* location in the page; rect.w is also the advance */
+} sf_Glyph;
+
+/* an immutable snapshot of the font's glyphs, see sharedfont.c */
+typedef struct sf_Table sf_Table;
+
+typedef struct { int y, h, x; } sf_Shelf;
+
+typedef struct {
+  unsigned char *pixels;  /* SF_PAGE_SIZE squared coverage bytes */
+  int used;
+  int shelf_count;
+  sf_Shelf shelves[SF_MAX_SHELVES];
+} sf_Page;
+
+/* a font shared by any number of contexts and threads; `mu_Font` can point
+** to it. Glyphs come from `glyph` (the glyph cache's source interface) */
+typedef struct {
+  _Atomic(sf_Table*) table;
+  int height;
+  gc_GlyphFn glyph;
+  void *udata;
+  /* only touched by writers, under `lock` */
+  pthread_mutex_t lock;
+  sf_Page pages[SF_MAX_PAGES];
+  int page_count;
+  sf_Table *retired;
+} sf_Font;
+
+void sf_init(sf_Font *font, gc_GlyphFn glyph, void *udata, int height);
+void sf_deinit(sf_Font *font);
+void sf_synchronize(sf_Font *font);
+ int sf_get_glyph(sf_Font *font, unsigned codepoint, sf_Glyph *g);
+ int sf_next_glyph(sf_Font *font, int *idx, sf_Glyph *g);
+const unsigned char* sf_get_pixels(sf_Font *font, int page);
+ int sf_text_width(sf_Font *font, const char *text, int len);
+ int sf_text_height(sf_Font *font);
+
+#endif
@@ -0,0 +1,310 @@
+/*
+** Software rasterizer for the microui command list. Draws into a caller
+** owned RGBA framebuffer using the same atlas, glyph placement and blend
+** equation as renderer.c so its output can be compared against the GL
+** renderers; blended pixels differ by at most a rounding step.
+**
+** Span fills and constant alpha blends use SSE2 when available; every
+** draw is clipped to the intersection of the current clip rect, the damage
+** rect and the framebuffer.
+**
+** Text is UTF-8 and drawn in a gc_Font (glyphcache.h). Glyph bitmaps are
+** read straight from the font's glyph source rather than through its cache,
+** so tiles can draw text from several threads at once.
+*/
+
+#include <stdint.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "swrender.h"
+#include "glyphcache.h"
+#include "atlas.inl"
+
+static gc_Font default_font = { NULL, sw_get_glyph, NULL, 18 };
+
+/* an empty box, drawn for codepoints without a glyph in the atlas */
+static const unsigned char tofu[17][7] = {
+  [ 3] = { 0, 255, 255, 255, 255, 255, 0 },
+  [ 4] = { 0, 255,   0,   0,   0, 255, 0 },
+  [ 5] = { 0, 255,   0,   0,   0, 255, 0 },
+  [ 6] = { 0, 255,   0,   0,   0, 255, 0 },
+  [ 7] = { 0, 255,   0,   0,   0, 255, 0 },
+  [ 8] = { 0, 255,   0,   0,   0, 255, 0 },
+  [ 9] = { 0, 255,   0,   0,   0, 255, 0 },
+  [10] = { 0, 255,   0,   0,   0, 255, 0 },
+  [11] = { 0, 255,   0,   0,   0, 255, 0 },
+  [12] = { 0, 255,   0,   0,   0, 255, 0 },
+  [13] = { 0, 255, 255, 255, 255, 255, 0 },
+};
+
+
+static mu_Rect intersect(mu_Rect a, mu_Rect b) {
+  int x1 = mu_max(a.x, b.x);
+  int y1 = mu_max(a.y, b.y);
+  int x2 = mu_min(a.x + a.w, b.x + b.w);
+  int y2 = mu_min(a.y + a.h, b.y + b.h);
+  if (x2 < x1) { x2 = x1; }
+  if (y2 < y1) { y2 = y1; }
+  return mu_rect(x1, y1, x2 - x1, y2 - y1);
+}
+
+
+static mu_Rect target_rect(sw_Canvas *c) {
+  return intersect(intersect(c->clip, c->damage), mu_rect(0, 0, c->w, c->h));
+}
+
+
+static uint32_t* pixel(sw_Canvas *c, int x, int y) {
+  return (uint32_t*) (c->pixels + ((size_t) y * c->w + x) * 4);
+}
+
+
+static void fill_span(uint32_t *dst, int n, uint32_t color) {
+#ifdef __SSE2__
+  __m128i v = _mm_set1_epi32((int) color);
+  for (; n >= 4; n -= 4, dst += 4) {
+    _mm_storeu_si128((__m128i*) dst, v);
+  }
+#endif
+  while (n--) { *dst++ = color; }
+}
+
+
+/* dst = (src * a + dst * (255 - a)) / 255, rounded, for all four channels */
+static void blend_span(uint32_t *dst, int n, mu_Color color) {
+  int a = color.a, ia = 255 - a;
+  int sr = color.r * a + 128, sg = color.g * a + 128;
+  int sb = color.b * a + 128, sa = color.a * a + 128;
+#ifdef __SSE2__
+  __m128i zero = _mm_setzero_si128();
+  __m128i s = _mm_setr_epi16(sr, sg, sb, sa, sr, sg, sb, sa);
+  __m128i f = _mm_set1_epi16(ia);
+  for (; n >= 4; n -= 4, dst += 4) {
+    __m128i d = _mm_loadu_si128((__m128i*) dst);
+    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), f), s);
+    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), f), s);
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+    _mm_storeu_si128((__m128i*) dst, _mm_packus_epi16(lo, hi));
+  }
+#endif
+  for (; n > 0; n--, dst++) {
+    unsigned char *p = (unsigned char*) dst;
+    int t;
+    t = p[0] * ia + sr; p[0] = (t + (t >> 8)) >> 8;
+    t = p[1] * ia + sg; p[1] = (t + (t >> 8)) >> 8;
+    t = p[2] * ia + sb; p[2] = (t + (t >> 8)) >> 8;
+    t = p[3] * ia + sa; p[3] = (t + (t >> 8)) >> 8;
+  }
+}
+
+
+/* as blend_span() for one pixel, with `a` being coverage * alpha (0..65025) */
+static void blend_pixel(unsigned char *p, mu_Color color, int a) {
+  int ia = 65025 - a;
+  p[0] = (p[0] * ia + color.r * a + 32512) / 65025;
+  p[1] = (p[1] * ia + color.g * a + 32512) / 65025;
+  p[2] = (p[2] * ia + color.b * a + 32512) / 65025;
+  p[3] = (p[3] * ia + color.a * a + 32512) / 65025;
+}
+
+
+static void fill_rect(sw_Canvas *c, mu_Rect r, mu_Color color) {
+  uint32_t packed;
+  int y;
+  r = intersect(r, target_rect(c));
+  if (r.w <= 0 || r.h <= 0 || color.a == 0) { return; }
+  memcpy(&packed, &color, 4);
+  for (y = r.y; y < r.y + r.h; y++) {
+    if (color.a == 255) {
+      fill_span(pixel(c, r.x, y), r.w, packed);
+    } else {
+      blend_span(pixel(c, r.x, y), r.w, color);
+    }
+  }
+}
+
+
+/* draws the w*h `coverage` bitmap, `pitch` bytes per row, at `dst` */
+static void draw_coverage(sw_Canvas *c, const unsigned char *coverage,
+  int w, int h, int pitch, mu_Vec2 dst, mu_Color color)
+{
+  int x, y;
+  mu_Rect r = intersect(mu_rect(dst.x, dst.y, w, h), target_rect(c));
+  for (y = r.y; y < r.y + r.h; y++) {
+    const unsigned char *texel = coverage + (y - dst.y) * pitch + r.x - dst.x;
+    unsigned char *p = (unsigned char*) pixel(c, r.x, y);
+    for (x = 0; x < r.w; x++, p += 4) {
+      int a = texel[x] * color.a;
+      if (a) { blend_pixel(p, color, a); }
+    }
+  }
+}
+
+
+void sw_init(sw_Canvas *c, unsigned char *pixels, int w, int h) {
+  c->pixels = pixels;
+  c->w = w;
+  c->h = h;
+  c->clip = c->damage = mu_rect(0, 0, w, h);
+}
+
+
+void sw_set_damage(sw_Canvas *c, mu_Rect rect) {
+  c->damage = rect;
+}
+
+
+void sw_set_clip_rect(sw_Canvas *c, mu_Rect rect) {
+  c->clip = rect;
+}
+
+
+void sw_clear(sw_Canvas *c, mu_Color color) {
+  uint32_t packed;
+  int y;
+  mu_Rect r = intersect(c->damage, mu_rect(0, 0, c->w, c->h));
+  memcpy(&packed, &color, 4);
+  for (y = r.y; y < r.y + r.h; y++) {
+    fill_span(pixel(c, r.x, y), r.w, packed);
+  }
+}
+
+
+void sw_draw_rect(sw_Canvas *c, mu_Rect rect, mu_Color color) {
+  fill_rect(c, rect, color);
+}
+
+
+void sw_draw_box(sw_Canvas *c, mu_Rect rect, mu_Color color) {
+  fill_rect(c, mu_rect(rect.x + 1, rect.y, rect.w - 2, 1), color);
+  fill_rect(c, mu_rect(rect.x + 1, rect.y + rect.h - 1, rect.w - 2, 1), color);
+  fill_rect(c, mu_rect(rect.x, rect.y, 1, rect.h), color);
+  fill_rect(c, mu_rect(rect.x + rect.w - 1, rect.y, 1, rect.h), color);
+}
+
+
+/* `font` is a gc_Font; NULL draws with the atlas font */
+static gc_Font* get_font(mu_Font font) {
+  return font ? font : &default_font;
+}
+
+
+void sw_draw_text(sw_Canvas *c, mu_Font font, const char *text, mu_Vec2 pos, mu_Color color) {
+  gc_Font *f = get_font(font);
+  unsigned codepoint;
+  int n, w, h, pitch;
+  while ((n = gc_decode_utf8(text, -1, &codepoint)) > 0) {
+    const unsigned char *coverage = f->glyph(f->udata, codepoint, &w, &h, &pitch);
+    text += n;
+    if (!coverage) { continue; }
+    draw_coverage(c, coverage, w, h, pitch, pos, color);
+    pos.x += w;
+  }
+}
+
+
+/* the area an icon drawn in `rect` covers: its atlas image, centred */
+mu_Rect sw_get_icon_rect(int id, mu_Rect rect) {
+  mu_Rect src = atlas[id];
+  return mu_rect(rect.x + (rect.w - src.w) / 2, rect.y + (rect.h - src.h) / 2,
+    src.w, src.h);
+}
+
+
+void sw_draw_icon(sw_Canvas *c, int id, mu_Rect rect, mu_Color color) {
+  mu_Rect src = atlas[id];
+  mu_Rect dst = sw_get_icon_rect(id, rect);
+  draw_coverage(c, atlas_texture + src.y * ATLAS_WIDTH + src.x,
+    src.w, src.h, ATLAS_WIDTH, mu_vec2(dst.x, dst.y), color);
+}
+
+
+void sw_draw_command(sw_Canvas *c, mu_Command *cmd) {
+  mu_Rect r;
+  int i;
+  switch (cmd->type) {
+    case MU_COMMAND_TEXT: sw_draw_text(c, cmd->text.font, cmd->text.str, cmd->text.pos, cmd->text.color); break;
+    case MU_COMMAND_RECT: sw_draw_rect(c, cmd->rect.rect, cmd->rect.color); break;
+    case MU_COMMAND_ICON: sw_draw_icon(c, cmd->icon.id, cmd->icon.rect, cmd->icon.color); break;
+    case MU_COMMAND_CLIP: sw_set_clip_rect(c, cmd->clip.rect); break;
+    case MU_COMMAND_BOX: sw_draw_box(c, cmd->box.rect, cmd->box.color); break;
+    case MU_COMMAND_FRAME:
+      r = cmd->frame.rect;
+      sw_draw_rect(c, r, cmd->frame.color);
+      sw_draw_box(c, mu_rect(r.x - 1, r.y - 1, r.w + 2, r.h + 2), cmd->frame.border);
+      break;
+    case MU_COMMAND_RECT_BATCH:
+      for (i = 0; i < cmd->rect_batch.count; i++) {
+        sw_draw_rect(c, cmd->rect_batch.rects[i], cmd->rect_batch.color);
+      }
+      break;
+    case MU_COMMAND_ICON_BATCH:
+      for (i = 0; i < cmd->icon_batch.count; i++) {
+        sw_draw_icon(c, cmd->icon_batch.id, cmd->icon_batch.rects[i], cmd->icon_batch.color);
+      }
+      break;
+  }
+}
+
+
+void sw_render(sw_Canvas *c, mu_Context *ctx) {
+  mu_Span spans[64];
+  mu_Command *cmd = NULL;
+  int i, n = mu_get_spans(ctx, spans, 64);
+  c->clip = mu_rect(0, 0, c->w, c->h);
+  if (n > 64) {
+    while (mu_next_command(ctx, &cmd)) { sw_draw_command(c, cmd); }
+    return;
+  }
+  /* walk each run of commands straight through */
+  for (i = 0; i < n; i++) {
+    char *p = (char*) spans[i].cmd, *end = p + spans[i].len;
+    for (; p != end; p += ((mu_Command*) p)->base.size) {
+      sw_draw_command(c, (mu_Command*) p);
+    }
+  }
+}
+
+
+int sw_get_text_width(mu_Font font, const char *text, int len) {
+  gc_Font *f = get_font(font);
+  unsigned codepoint;
+  int n, w, h, pitch, res = 0;
+  while ((n = gc_decode_utf8(text, len, &codepoint)) > 0) {
+    if (f->glyph(f->udata, codepoint, &w, &h, &pitch)) { res += w; }
+    text += n;
+    if (len > 0) { len -= n; }
+  }
+  return res;
+}
+
+
+int sw_get_text_height(mu_Font font) {
+  return get_font(font)->height;
+}
+
+
+mu_Font sw_get_font(void) {
+  return &default_font;
+}
+
+
+/* the glyph drawn for `codepoint` in the atlas font: its ASCII glyphs, with
+** an empty box standing in for every other codepoint as in the GL renderers.
+** Usable as the glyph source of any gc_Font or shared font */
+const unsigned char* sw_get_glyph(void *udata, unsigned codepoint,
+  int *w, int *h, int *pitch)
+{
+  mu_Rect src;
+  (void) udata;
+  if (codepoint < 32 || codepoint > 127) {
+    *w = 7; *h = 17; *pitch = 7;
+    return &tofu[0][0];
+  }
+  src = atlas[ATLAS_FONT + codepoint];
+  *w = src.w; *h = src.h; *pitch = ATLAS_WIDTH;
+  return atlas_texture + src.y * ATLAS_WIDTH + src.x;
+}
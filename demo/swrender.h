@@ -0,0 +1,37 @@
+#ifndef SWRENDER_H
+#define SWRENDER_H
+
+#include "microui/microui.h"
+
+typedef struct {
+  unsigned char *pixels;  /* RGBA, w * h * 4 bytes */
+  int w, h;
+  mu_Rect clip;           /* current clip rect, as set by MU_COMMAND_CLIP */
+  mu_Rect damage;         /* all drawing is restricted to this rect */
+} sw_Canvas;
+
+void sw_init(sw_Canvas *c, unsigned char *pixels, int w, int h);
+void sw_set_damage(sw_Canvas *c, mu_Rect rect);
+void sw_set_clip_rect(sw_Canvas *c, mu_Rect rect);
+void sw_clear(sw_Canvas *c, mu_Color color);
+void sw_draw_rect(sw_Canvas *c, mu_Rect rect, mu_Color color);
+void sw_draw_box(sw_Canvas *c, mu_Rect rect, mu_Color color);
+void sw_draw_text(sw_Canvas *c, mu_Font font, const char *text, mu_Vec2 pos, mu_Color color);
+void sw_draw_icon(sw_Canvas *c, int id, mu_Rect rect, mu_Color color);
+void sw_draw_command(sw_Canvas *c, mu_Command *cmd);
+void sw_render(sw_Canvas *c, mu_Context *ctx);
+ int sw_get_text_width(mu_Font font, const char *text, int len);
+ int sw_get_text_height(mu_Font font);
+mu_Font sw_get_font(void);
+mu_Rect sw_get_icon_rect(int id, mu_Rect rect);
+const unsigned char* sw_get_glyph(void *udata, unsigned codepoint,
+  int *w, int *h, int *pitch);
+
+/* tiled multithreaded rendering, see swtiles.c */
+typedef struct sw_Tiler sw_Tiler;
+
+sw_Tiler* sw_tiler_create(int threads);
+void sw_tiler_destroy(sw_Tiler *t);
+void sw_render_tiled(sw_Tiler *t, sw_Canvas *c, mu_Context *ctx, const mu_Color *clear);
+
+#endif
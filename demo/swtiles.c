@@ -0,0 +1,250 @@
+/*
+** Tile based parallel rendering for swrender.c. The command list is binned
+** into TILE_SIZE square screen tiles in a single pass, recording for every
+** draw command the clip rect that was active when it was reached. Tiles are
+** then rasterized independently by a pool of threads; within a tile
+** commands keep their original order so the result matches sw_render().
+*/
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "swrender.h"
+
+#define TILE_SIZE   64
+#define MAX_THREADS 64
+
+typedef struct { mu_Command *cmd; int clip; } Entry;
+typedef struct { Entry *items; int count, cap; } TileList;
+
+struct sw_Tiler {
+  pthread_t threads[MAX_THREADS];
+  int thread_count;
+  pthread_mutex_t mutex;
+  pthread_cond_t start, done;
+  int generation, quit;
+  int next_tile, tiles_done;
+  /* current job */
+  sw_Canvas *canvas;
+  const mu_Color *clear;
+  int cols, rows;
+  TileList *tiles;
+  int tile_cap;
+  mu_Rect *clips;
+  int clip_count, clip_cap;
+};
+
+
+static mu_Rect intersect(mu_Rect a, mu_Rect b) {
+  int x1 = mu_max(a.x, b.x);
+  int y1 = mu_max(a.y, b.y);
+  int x2 = mu_min(a.x + a.w, b.x + b.w);
+  int y2 = mu_min(a.y + a.h, b.y + b.h);
+  if (x2 < x1) { x2 = x1; }
+  if (y2 < y1) { y2 = y1; }
+  return mu_rect(x1, y1, x2 - x1, y2 - y1);
+}
+
+
+static mu_Rect rect_union(mu_Rect a, mu_Rect b) {
+  int x1 = mu_min(a.x, b.x);
+  int y1 = mu_min(a.y, b.y);
+  int x2 = mu_max(a.x + a.w, b.x + b.w);
+  int y2 = mu_max(a.y + a.h, b.y + b.h);
+  return mu_rect(x1, y1, x2 - x1, y2 - y1);
+}
+
+
+static void* grow(void *items, int *cap, int count, int size) {
+  if (count < *cap) { return items; }
+  *cap = *cap ? *cap * 2 : 64;
+  items = realloc(items, (size_t) *cap * size);
+  if (!items) { abort(); }
+  return items;
+}
+
+
+/* screen space bounds of a draw command, empty for non-drawing commands */
+static mu_Rect command_bounds(mu_Command *cmd) {
+  mu_Rect r = mu_rect(0, 0, 0, 0);
+  int i;
+  switch (cmd->type) {
+    case MU_COMMAND_RECT: return cmd->rect.rect;
+    case MU_COMMAND_ICON: return sw_get_icon_rect(cmd->icon.id, cmd->icon.rect);
+    case MU_COMMAND_BOX:  return cmd->box.rect;
+    case MU_COMMAND_FRAME:
+      r = cmd->frame.rect;
+      return mu_rect(r.x - 1, r.y - 1, r.w + 2, r.h + 2);
+    case MU_COMMAND_TEXT:
+      return mu_rect(cmd->text.pos.x, cmd->text.pos.y,
+        cmd->text.width, sw_get_text_height(cmd->text.font));
+    case MU_COMMAND_RECT_BATCH:
+      for (i = 0; i < cmd->rect_batch.count; i++) {
+        r = i ? rect_union(r, cmd->rect_batch.rects[i]) : cmd->rect_batch.rects[i];
+      }
+      return r;
+    case MU_COMMAND_ICON_BATCH:
+      for (i = 0; i < cmd->icon_batch.count; i++) {
+        mu_Rect icon = sw_get_icon_rect(cmd->icon_batch.id, cmd->icon_batch.rects[i]);
+        r = i ? rect_union(r, icon) : icon;
+      }
+      return r;
+  }
+  return r;
+}
+
+
+/* bins into a `cols` * `rows` grid; the job's own cols and rows are only
+** set under the mutex once binning is done, as a worker still leaving the
+** last job may read them */
+static void bin_commands(sw_Tiler *t, sw_Canvas *c, mu_Context *ctx, int cols, int rows) {
+  mu_Command *cmd = NULL;
+  mu_Rect screen = intersect(c->damage, mu_rect(0, 0, c->w, c->h));
+  int i, n = cols * rows;
+
+  if (n > t->tile_cap) {
+    t->tiles = realloc(t->tiles, n * sizeof(TileList));
+    if (!t->tiles) { abort(); }
+    memset(t->tiles + t->tile_cap, 0, (n - t->tile_cap) * sizeof(TileList));
+    t->tile_cap = n;
+  }
+  for (i = 0; i < n; i++) { t->tiles[i].count = 0; }
+
+  t->clip_count = 0;
+  t->clips = grow(t->clips, &t->clip_cap, t->clip_count, sizeof(mu_Rect));
+  t->clips[t->clip_count++] = mu_rect(0, 0, c->w, c->h);
+
+  while (mu_next_command(ctx, &cmd)) {
+    mu_Rect r;
+    int x, y, x1, y1, x2, y2;
+    if (cmd->type == MU_COMMAND_CLIP) {
+      t->clips = grow(t->clips, &t->clip_cap, t->clip_count, sizeof(mu_Rect));
+      t->clips[t->clip_count++] = cmd->clip.rect;
+      continue;
+    }
+    r = intersect(command_bounds(cmd), t->clips[t->clip_count - 1]);
+    r = intersect(r, screen);
+    if (r.w <= 0 || r.h <= 0) { continue; }
+    x1 = r.x / TILE_SIZE; x2 = (r.x + r.w - 1) / TILE_SIZE;
+    y1 = r.y / TILE_SIZE; y2 = (r.y + r.h - 1) / TILE_SIZE;
+    for (y = y1; y <= y2; y++) {
+      for (x = x1; x <= x2; x++) {
+        TileList *tl = &t->tiles[y * cols + x];
+        tl->items = grow(tl->items, &tl->cap, tl->count, sizeof(Entry));
+        tl->items[tl->count].cmd = cmd;
+        tl->items[tl->count].clip = t->clip_count - 1;
+        tl->count++;
+      }
+    }
+  }
+}
+
+
+static void draw_tile(sw_Tiler *t, int idx, int cols) {
+  TileList *tl = &t->tiles[idx];
+  sw_Canvas tc = *t->canvas;
+  int i, x = idx % cols, y = idx / cols;
+  tc.damage = intersect(tc.damage,
+    mu_rect(x * TILE_SIZE, y * TILE_SIZE, TILE_SIZE, TILE_SIZE));
+  if (t->clear) { sw_clear(&tc, *t->clear); }
+  for (i = 0; i < tl->count; i++) {
+    tc.clip = t->clips[tl->items[i].clip];
+    sw_draw_command(&tc, tl->items[i].cmd);
+  }
+}
+
+
+static void run_tiles(sw_Tiler *t) {
+  for (;;) {
+    int idx, n, cols;
+    /* the tile and the job's size are taken together, in case the next
+    ** job was started since this thread last looked */
+    pthread_mutex_lock(&t->mutex);
+    idx = t->next_tile++;
+    cols = t->cols;
+    n = t->cols * t->rows;
+    pthread_mutex_unlock(&t->mutex);
+    if (idx >= n) { return; }
+    draw_tile(t, idx, cols);
+    pthread_mutex_lock(&t->mutex);
+    if (++t->tiles_done == n) { pthread_cond_signal(&t->done); }
+    pthread_mutex_unlock(&t->mutex);
+  }
+}
+
+
+static void* worker(void *udata) {
+  sw_Tiler *t = udata;
+  int seen = 0;
+  for (;;) {
+    pthread_mutex_lock(&t->mutex);
+    while (t->generation == seen && !t->quit) {
+      pthread_cond_wait(&t->start, &t->mutex);
+    }
+    seen = t->generation;
+    if (t->quit) { pthread_mutex_unlock(&t->mutex); return NULL; }
+    pthread_mutex_unlock(&t->mutex);
+    run_tiles(t);
+  }
+}
+
+
+sw_Tiler* sw_tiler_create(int threads) {
+  int i;
+  sw_Tiler *t = calloc(1, sizeof(sw_Tiler));
+  if (!t) { abort(); }
+  pthread_mutex_init(&t->mutex, NULL);
+  pthread_cond_init(&t->start, NULL);
+  pthread_cond_init(&t->done, NULL);
+  /* the calling thread works on tiles too */
+  t->thread_count = mu_clamp(threads - 1, 0, MAX_THREADS);
+  for (i = 0; i < t->thread_count; i++) {
+    pthread_create(&t->threads[i], NULL, worker, t);
+  }
+  return t;
+}
+
+
+void sw_tiler_destroy(sw_Tiler *t) {
+  int i;
+  pthread_mutex_lock(&t->mutex);
+  t->quit = 1;
+  pthread_cond_broadcast(&t->start);
+  pthread_mutex_unlock(&t->mutex);
+  for (i = 0; i < t->thread_count; i++) {
+    pthread_join(t->threads[i], NULL);
+  }
+  for (i = 0; i < t->tile_cap; i++) { free(t->tiles[i].items); }
+  free(t->tiles);
+  free(t->clips);
+  pthread_mutex_destroy(&t->mutex);
+  pthread_cond_destroy(&t->start);
+  pthread_cond_destroy(&t->done);
+  free(t);
+}
+
+
+void sw_render_tiled(sw_Tiler *t, sw_Canvas *c, mu_Context *ctx,
+  const mu_Color *clear)
+{
+  int cols = (c->w + TILE_SIZE - 1) / TILE_SIZE;
+  int rows = (c->h + TILE_SIZE - 1) / TILE_SIZE;
+  bin_commands(t, c, ctx, cols, rows);
+
+  pthread_mutex_lock(&t->mutex);
+  t->canvas = c;
+  t->clear = clear;
+  t->cols = cols;
+  t->rows = rows;
+  t->next_tile = 0;
+  t->tiles_done = 0;
+  t->generation++;
+  pthread_cond_broadcast(&t->start);
+  pthread_mutex_unlock(&t->mutex);
+
+  run_tiles(t);
+
+  pthread_mutex_lock(&t->mutex);
+  while (t->tiles_done < cols * rows) { pthread_cond_wait(&t->done, &t->mutex); }
+  pthread_mutex_unlock(&t->mutex);
+}
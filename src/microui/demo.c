@@ -1,19 +1,24 @@
-#include "microui.h"
+#include "demo.h"
 #include <stdio.h>
 #include <string.h>
 
-float mu_demo_bg[3] = {90, 95, 100};
-
+/* state of the plain mu_demo(), set up on its first call */
 static char logbuf[64000];
-static int logbuf_updated = 0;
-
-static void write_log(const char *text) {
-  if (logbuf[0]) { strcat(logbuf, "\n"); }
-  strcat(logbuf, text);
-  logbuf_updated = 1;
+static mu_DemoState state;
+
+float mu_demo_bg[3] = { 90, 95, 100 };
+
+static void write_log(mu_DemoState *st, const char *text) {
+  int len = strlen(st->log);
+  /* start over once the buffer is full */
+  if (len + (int) strlen(text) + 2 > st->log_size) { st->log[0] = '\0'; len = 0; }
+  if (len) { strcat(st->log, "\n"); }
+  strncat(st->log, text, st->log_size - len - 2);
+  st->log_updated = 1;
+  st->log_version++;
 }
 
-static void test_window(mu_Context *ctx) {
+static void test_window(mu_Context *ctx, mu_DemoState *st) {
   /* do window */
   if (mu_begin_window(ctx, "Demo Window", mu_rect(40, 40, 300, 450))) {
     mu_Container *win = mu_get_current_container(ctx);
@@ -35,10 +40,10 @@ static void test_window(mu_Context *ctx) {
     if (mu_header_ex(ctx, "Test Buttons", MU_OPT_EXPANDED)) {
       mu_layout_row(ctx, 3, (const int[]) { 86, -110, -1 }, 0);
       mu_label(ctx, "Test buttons 1:");
-      if (mu_button(ctx, "Button 1")) { write_log("Pressed button 1"); }
-      if (mu_button(ctx, "Button 2")) { write_log("Pressed button 2"); }
+      if (mu_button(ctx, "Button 1")) { write_log(st, "Pressed button 1"); }
+      if (mu_button(ctx, "Button 2")) { write_log(st, "Pressed button 2"); }
       mu_label(ctx, "Test buttons 2:");
-      if (mu_button(ctx, "Button 3")) { write_log("Pressed button 3"); }
+      if (mu_button(ctx, "Button 3")) { write_log(st, "Pressed button 3"); }
       if (mu_button(ctx, "Popup")) { mu_open_popup(ctx, "Test Popup"); }
       if (mu_begin_popup(ctx, "Test Popup")) {
         mu_button(ctx, "Hello");
@@ -58,25 +63,24 @@ static void test_window(mu_Context *ctx) {
           mu_end_treenode(ctx);
         }
         if (mu_begin_treenode(ctx, "Test 1b")) {
-          if (mu_button(ctx, "Button 1")) { write_log("Pressed button 1"); }
-          if (mu_button(ctx, "Button 2")) { write_log("Pressed button 2"); }
+          if (mu_button(ctx, "Button 1")) { write_log(st, "Pressed button 1"); }
+          if (mu_button(ctx, "Button 2")) { write_log(st, "Pressed button 2"); }
           mu_end_treenode(ctx);
         }
         mu_end_treenode(ctx);
       }
       if (mu_begin_treenode(ctx, "Test 2")) {
         mu_layout_row(ctx, 2, (const int[]) { 54, 54 }, 0);
-        if (mu_button(ctx, "Button 3")) { write_log("Pressed button 3"); }
-        if (mu_button(ctx, "Button 4")) { write_log("Pressed button 4"); }
-        if (mu_button(ctx, "Button 5")) { write_log("Pressed button 5"); }
-        if (mu_button(ctx, "Button 6")) { write_log("Pressed button 6"); }
+        if (mu_button(ctx, "Button 3")) { write_log(st, "Pressed button 3"); }
+        if (mu_button(ctx, "Button 4")) { write_log(st, "Pressed button 4"); }
+        if (mu_button(ctx, "Button 5")) { write_log(st, "Pressed button 5"); }
+        if (mu_button(ctx, "Button 6")) { write_log(st, "Pressed button 6"); }
         mu_end_treenode(ctx);
       }
       if (mu_begin_treenode(ctx, "Test 3")) {
-        static int checks[3] = { 1, 0, 1 };
-        mu_checkbox(ctx, "Checkbox 1", &checks[0]);
-        mu_checkbox(ctx, "Checkbox 2", &checks[1]);
-        mu_checkbox(ctx, "Checkbox 3", &checks[2]);
+        mu_checkbox(ctx, "Checkbox 1", &st->checks[0]);
+        mu_checkbox(ctx, "Checkbox 2", &st->checks[1]);
+        mu_checkbox(ctx, "Checkbox 3", &st->checks[2]);
         mu_end_treenode(ctx);
       }
       mu_layout_end_column(ctx);
@@ -91,8 +95,7 @@ static void test_window(mu_Context *ctx) {
 
     /* background color sliders */
     if (mu_header_ex(ctx, "Background Color", MU_OPT_EXPANDED)) {
-      static int do_button = 0;
-      mu_checkbox(ctx, "use button for the right layout", &do_button);
+      mu_checkbox(ctx, "use button for the right layout", &st->do_button);
       int content_height = 10;
       int row_height = 3*(10*content_height +2*ctx->style->padding + ctx->style->spacing) - ctx->style->spacing;
       (void)row_height;
@@ -105,9 +108,9 @@ static void test_window(mu_Context *ctx) {
       mu_layout_row(ctx, 2, (const int[]) { 46, -1 }, 0);
       mu_Rect rect1 = mu_layout_next(ctx);
       mu_layout_set_next(ctx, rect1, 0);
-      mu_label(ctx, "Red:");   mu_slider(ctx, &mu_demo_bg[0], 0, 255);
-      mu_label(ctx, "Green:"); mu_slider(ctx, &mu_demo_bg[1], 0, 255);
-      mu_label(ctx, "Blue:");  mu_slider(ctx, &mu_demo_bg[2], 0, 255);
+      mu_label(ctx, "Red:");   mu_slider(ctx, &st->bg[0], 0, 255);
+      mu_label(ctx, "Green:"); mu_slider(ctx, &st->bg[1], 0, 255);
+      mu_label(ctx, "Blue:");  mu_slider(ctx, &st->bg[2], 0, 255);
       mu_Rect rect2 = mu_layout_next(ctx);
       mu_layout_set_next(ctx, rect2, 0);
       mu_layout_end_column(ctx);
@@ -119,18 +122,15 @@ static void test_window(mu_Context *ctx) {
       // correct value)
       r.h = rect2.y-rect1.y - ctx->style->spacing;
       char buf[32];
-      sprintf(buf, "#%02X%02X%02X", (int)mu_demo_bg[0], (int)mu_demo_bg[1], (int)mu_demo_bg[2]);
-      if(do_button) {
+      sprintf(buf, "#%02X%02X%02X", (int)st->bg[0], (int)st->bg[1], (int)st->bg[2]);
+      if(st->do_button) {
         mu_layout_set_next(ctx, r, 0);
-        mu_Color *color = &ctx->style->colors[MU_COLOR_BUTTON];
-        mu_Color prev_color = *color;
-        color->r = mu_demo_bg[0];
-        color->g = mu_demo_bg[1];
-        color->b = mu_demo_bg[2];
+        mu_push_style_color(ctx, MU_COLOR_BUTTON,
+          mu_color(st->bg[0], st->bg[1], st->bg[2], ctx->style->colors[MU_COLOR_BUTTON].a));
         mu_button(ctx, buf);
-        *color = prev_color;
+        mu_pop_style(ctx, 1);
       } else {
-        mu_draw_rect(ctx, r, mu_color(mu_demo_bg[0], mu_demo_bg[1], mu_demo_bg[2], 255));
+        mu_draw_rect(ctx, r, mu_color(st->bg[0], st->bg[1], st->bg[2], 255));
         mu_draw_control_text(ctx, buf, r, MU_COLOR_TEXT, MU_OPT_ALIGNCENTER);
       }
     }
@@ -139,50 +139,63 @@ static void test_window(mu_Context *ctx) {
   }
 }
 
-static void log_window(mu_Context *ctx) {
+static void log_window(mu_Context *ctx, mu_DemoState *st) {
   if (mu_begin_window(ctx, "Log Window", mu_rect(350, 40, 300, 200))) {
     /* output text panel */
     mu_layout_row(ctx, 1, (const int[]) { -1 }, -25);
-    mu_begin_panel(ctx, "Log Output");
-    mu_Container *panel = mu_get_current_container(ctx);
-    mu_layout_row(ctx, 1, (const int[]) { -1 }, -1);
-    mu_text(ctx, logbuf);
-    mu_end_panel(ctx);
-    if (logbuf_updated) {
+    if (mu_begin_panel_cached(ctx, "Log Output", 0, st->log_version)) {
+      mu_layout_row(ctx, 1, (const int[]) { -1 }, -1);
+      mu_text(ctx, st->log);
+      mu_end_panel(ctx);
+    }
+    mu_Container *panel = mu_get_container(ctx, "Log Output");
+    if (st->log_updated) {
       panel->scroll.y = panel->content_size.y;
-      logbuf_updated = 0;
+      st->log_updated = 0;
     }
 
     /* input textbox + submit button */
-    static char buf[128];
     int submitted = 0;
     mu_layout_row(ctx, 2, (const int[]) { -70, -1 }, 0);
-    if (mu_textbox(ctx, buf, sizeof(buf)) & MU_RES_SUBMIT) {
+    if (mu_textbox(ctx, st->input, sizeof(st->input)) & MU_RES_SUBMIT) {
       mu_set_focus(ctx, ctx->last_id);
       submitted = 1;
     }
     if (mu_button(ctx, "Submit")) { submitted = 1; }
     if (submitted) {
-      write_log(buf);
-      buf[0] = '\0';
+      write_log(st, st->input);
+      st->input[0] = '\0';
     }
 
     mu_end_window(ctx);
   }
 }
 
-static int uint8_slider(mu_Context *ctx, unsigned char *value, int low, int high) {
-  static float tmp;
-  mu_push_id(ctx, &value, sizeof(value));
-  tmp = *value;
-  int res = mu_slider_ex(ctx, &tmp, low, high, 0, "%.0f", MU_OPT_ALIGNCENTER);
-  *value = tmp;
+/* edits one channel of a style color. The slider's id comes from `colorid`
+** and `channel`, as a style the context doesn't own (one shared by several
+** contexts) is first copied into the context, moving the value edited */
+static int color_slider(mu_Context *ctx, mu_DemoState *st, int colorid, int channel) {
+  mu_Color color = ctx->style->colors[colorid];
+  unsigned char *value = (unsigned char*) &color + channel;
+  int id = colorid * 4 + channel;
+  mu_push_id(ctx, &id, sizeof(id));
+  st->slider = *value;
+  int res = mu_slider_ex(ctx, &st->slider, 0, 255, 0, "%.0f", MU_OPT_ALIGNCENTER);
+  if (res & MU_RES_CHANGE) {
+    *value = st->slider;
+    if (ctx->style != &ctx->_style) {
+      ctx->_style = *ctx->style;
+      ctx->style = &ctx->_style;
+    }
+    ctx->style->colors[colorid] = color;
+    mu_style_changed(ctx);
+  }
   mu_pop_id(ctx);
   return res;
 }
 
-static void style_window(mu_Context *ctx) {
-  static struct { const char *label; int idx; } colors[] = {
+static void style_window(mu_Context *ctx, mu_DemoState *st) {
+  static const struct { const char *label; int idx; } colors[] = {
     { "text:",         MU_COLOR_TEXT        },
     { "border:",       MU_COLOR_BORDER      },
     { "windowbg:",     MU_COLOR_WINDOWBG    },
@@ -206,18 +219,31 @@ static void style_window(mu_Context *ctx) {
     mu_layout_row(ctx, 6, widths , 0);
     for (int i = 0; colors[i].label; i++) {
       mu_label(ctx, colors[i].label);
-      uint8_slider(ctx, &ctx->style->colors[i].r, 0, 255);
-      uint8_slider(ctx, &ctx->style->colors[i].g, 0, 255);
-      uint8_slider(ctx, &ctx->style->colors[i].b, 0, 255);
-      uint8_slider(ctx, &ctx->style->colors[i].a, 0, 255);
+      for (int c = 0; c < 4; c++) { color_slider(ctx, st, i, c); }
       mu_draw_rect(ctx, mu_layout_next(ctx), ctx->style->colors[i]);
     }
     mu_end_window(ctx);
   }
 }
 
+void mu_demo_init(mu_DemoState *st, char *log, int log_size) {
+  memset(st, 0, sizeof(*st));
+  st->bg[0] = 90; st->bg[1] = 95; st->bg[2] = 100;
+  st->log = log;
+  st->log_size = log_size;
+  st->log[0] = '\0';
+  st->checks[0] = st->checks[2] = 1;
+}
+
+void mu_demo_ex(mu_Context *ctx, mu_DemoState *st) {
+  style_window(ctx, st);
+  log_window(ctx, st);
+  test_window(ctx, st);
+}
+
 void mu_demo(mu_Context *ctx) {
-  style_window(ctx);
-  log_window(ctx);
-  test_window(ctx);
+  if (!state.log) { mu_demo_init(&state, logbuf, sizeof(logbuf)); }
+  memcpy(state.bg, mu_demo_bg, sizeof(state.bg));
+  mu_demo_ex(ctx, &state);
+  memcpy(mu_demo_bg, state.bg, sizeof(state.bg));
 }
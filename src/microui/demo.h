@@ -2,9 +2,24 @@
 #define MICROUI_DEMO_H
 #include "microui.h"
 
+/* everything the demo windows keep between frames; one per context */
+typedef struct {
+  float bg[3];
+  char *log;        /* log window text, `log_size` bytes owned by the caller */
+  int log_size;
+  int log_updated;
+  int log_version;
+  int checks[3];
+  int do_button;
+  char input[128];  /* log window textbox */
+  float slider;     /* value edited by the style editor's sliders */
+} mu_DemoState;
+
 // used in demo/main.c
 extern float mu_demo_bg[3];
 
+void mu_demo_init(mu_DemoState *st, char *log, int log_size);
+void mu_demo_ex(mu_Context *, mu_DemoState *st);
 void mu_demo(mu_Context *);
 
 #endif
@@ -0,0 +1,521 @@
+/*
+** Copyright (c) 2020 rxi
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the MIT license. See `microui.c` for details.
+*/
+
+/*
+** Multi-line text editor control. The text is a piece table over the
+** caller's original text and an append-only add buffer, so edits never move
+** existing text. Both buffers keep a sorted index of their '\n' offsets and
+** every piece caches its document offset and the number of lines before it;
+** finding the start of a line or the line of an offset is a binary search
+** over the pieces followed by one over a newline index. Only the lines
+** inside the clip rect are measured and drawn, and the width of a line is
+** kept until it is edited.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "editor.h"
+#include "internal.h"
+
+
+/*============================================================================
+** piece table
+**============================================================================*/
+
+static int lower_bound(const int *a, int n, int value) {
+  int lo = 0, hi = n;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (a[mid] < value) { lo = mid + 1; } else { hi = mid; }
+  }
+  return lo;
+}
+
+
+static const char* buffer_text(mu_Editor *ed, int add) {
+  return add ? ed->add : ed->orig;
+}
+
+
+static int count_newlines(mu_Editor *ed, int add, int start, int end) {
+  const int *nl = add ? ed->add_nl : ed->orig_nl;
+  int n = add ? ed->add_nl_count : ed->orig_nl_count;
+  return lower_bound(nl, n, end) - lower_bound(nl, n, start);
+}
+
+
+static void set_piece(mu_Editor *ed, mu_Piece *p, int add, int start, int len) {
+  p->add = add;
+  p->start = start;
+  p->len = len;
+  p->lines = count_newlines(ed, add, start, start + len);
+}
+
+
+/* recomputes the cached offsets of the pieces from `idx` on */
+static void update_pieces(mu_Editor *ed, int idx) {
+  int pos = 0, line = 0;
+  if (idx > 0) {
+    mu_Piece *p = &ed->pieces[idx - 1];
+    pos = p->pos + p->len;
+    line = p->line + p->lines;
+  }
+  for (; idx < ed->piece_count; idx++) {
+    mu_Piece *p = &ed->pieces[idx];
+    p->pos = pos;
+    p->line = line;
+    pos += p->len;
+    line += p->lines;
+  }
+  ed->len = pos;
+  ed->lines = line;
+}
+
+
+static void insert_pieces(mu_Editor *ed, int idx, int n) {
+  memmove(ed->pieces + idx + n, ed->pieces + idx,
+    (ed->piece_count - idx) * sizeof(mu_Piece));
+  ed->piece_count += n;
+}
+
+
+/* index of the piece containing `pos`, or the last piece for the end of the
+** document */
+static int find_piece(mu_Editor *ed, int pos) {
+  int lo = 0, hi = ed->piece_count - 1;
+  while (lo < hi) {
+    int mid = (lo + hi + 1) / 2;
+    if (ed->pieces[mid].pos <= pos) { lo = mid; } else { hi = mid - 1; }
+  }
+  return lo;
+}
+
+
+static int byte_at(mu_Editor *ed, int pos) {
+  mu_Piece *p = &ed->pieces[find_piece(ed, pos)];
+  return (unsigned char) buffer_text(ed, p->add)[p->start + pos - p->pos];
+}
+
+
+/* the contiguous run of text at `pos`, stopping at `end` or the end of the
+** piece and holding at most MU_EDITOR_RUNSIZE bytes */
+static int get_run(mu_Editor *ed, int pos, int end, const char **text) {
+  mu_Piece *p = &ed->pieces[find_piece(ed, pos)];
+  int n = mu_min(p->pos + p->len, end) - pos;
+  *text = buffer_text(ed, p->add) + p->start + (pos - p->pos);
+  if (n > MU_EDITOR_RUNSIZE) {
+    /* cut at a character boundary */
+    n = MU_EDITOR_RUNSIZE;
+    while (n > 1 && ((*text)[n] & 0xc0) == 0x80) { n--; }
+  }
+  return n;
+}
+
+
+/* forgets the widths of `line` and, if lines were added or removed, of the
+** lines after it */
+static void drop_widths(mu_Editor *ed, int line, int moved) {
+  int i;
+  for (i = 0; i < MU_EDITOR_WIDTHCACHE_SIZE; i++) {
+    mu_LineWidth *w = &ed->widths[i];
+    if (w->line == line || (moved && w->line > line)) { w->line = -1; }
+  }
+}
+
+
+int mu_editor_init(mu_Editor *ed, const char *text, int len) {
+  const char *p = text, *end = text + len;
+  ed->orig_nl_count = 0;
+  while ((p = memchr(p, '\n', end - p))) {
+    /* no room to index this line: keep the text before it */
+    if (ed->orig_nl_count == ed->orig_nl_cap) { len = p - text; break; }
+    ed->orig_nl[ed->orig_nl_count++] = p++ - text;
+  }
+  if (ed->piece_cap == 0) { len = 0; }
+  ed->orig = text;
+  ed->orig_len = len;
+  ed->add_len = 0;
+  ed->add_nl_count = 0;
+  ed->piece_count = 0;
+  if (len > 0) {
+    set_piece(ed, &ed->pieces[0], 0, 0, len);
+    ed->piece_count = 1;
+  }
+  update_pieces(ed, 0);
+  ed->cursor = ed->target_x = ed->max_width = ed->follow = 0;
+  drop_widths(ed, 0, 1);
+  ed->width_font = NULL;
+  return len;
+}
+
+
+int mu_editor_insert(mu_Editor *ed, int pos, const char *text, int len) {
+  int i, k, prev, nl = ed->add_nl_count, start = ed->add_len;
+  mu_Piece *p;
+  pos = mu_clamp(pos, 0, ed->len);
+
+  /* truncate to the room left in the add buffer and its newline index */
+  if (len > ed->add_cap - ed->add_len) {
+    len = ed->add_cap - ed->add_len;
+    while (len > 0 && (text[len] & 0xc0) == 0x80) { len--; }
+  }
+  for (i = 0; i < len; i++) {
+    if (text[i] != '\n') { continue; }
+    if (nl == ed->add_nl_cap) { len = i; break; }
+    nl++;
+  }
+  if (len <= 0) { return 0; }
+  drop_widths(ed, mu_editor_line_of(ed, pos), nl > ed->add_nl_count);
+
+  /* find the piece ending at `pos`; -1 if none, -2 if `pos` is mid-piece */
+  k = find_piece(ed, pos);
+  if (ed->piece_count == 0) {
+    prev = -1;
+  } else if (pos == ed->len) {
+    prev = ed->piece_count - 1;
+  } else if (pos == ed->pieces[k].pos) {
+    prev = k - 1;
+  } else {
+    prev = -2;
+  }
+  p = prev >= 0 ? &ed->pieces[prev] : NULL;
+
+  /* make sure we have the pieces needed, typing at the end of the last
+  ** insertion needs none as the piece is extended */
+  if (!(p && p->add && p->start + p->len == ed->add_len)) {
+    if (ed->piece_count + (prev == -2 ? 2 : 1) > ed->piece_cap) { return 0; }
+  }
+
+  /* append to the add buffer */
+  memcpy(ed->add + ed->add_len, text, len);
+  for (i = 0; i < len; i++) {
+    if (text[i] == '\n') { ed->add_nl[ed->add_nl_count++] = ed->add_len + i; }
+  }
+  ed->add_len += len;
+
+  if (p && p->add && p->start + p->len == start) {
+    set_piece(ed, p, 1, p->start, p->len + len);
+    update_pieces(ed, prev);
+  } else if (prev != -2) {
+    insert_pieces(ed, prev + 1, 1);
+    set_piece(ed, &ed->pieces[prev + 1], 1, start, len);
+    update_pieces(ed, prev + 1);
+  } else {
+    /* split piece k around the new text */
+    mu_Piece old = ed->pieces[k];
+    int off = pos - old.pos;
+    insert_pieces(ed, k + 1, 2);
+    set_piece(ed, &ed->pieces[k], old.add, old.start, off);
+    set_piece(ed, &ed->pieces[k + 1], 1, start, len);
+    set_piece(ed, &ed->pieces[k + 2], old.add, old.start + off, old.len - off);
+    update_pieces(ed, k);
+  }
+
+  if (ed->cursor > pos) { ed->cursor += len; }
+  return len;
+}
+
+
+void mu_editor_delete(mu_Editor *ed, int pos, int len) {
+  int a = mu_clamp(pos, 0, ed->len);
+  int b = mu_clamp(pos + len, a, ed->len);
+  int i, j;
+  mu_Piece pi, pj;
+  if (a == b) { return; }
+  i = mu_editor_line_of(ed, a);
+  drop_widths(ed, i, mu_editor_line_of(ed, b) != i);
+  i = find_piece(ed, a);
+  j = find_piece(ed, b - 1);
+  pi = ed->pieces[i];
+  pj = ed->pieces[j];
+
+  if (i == j && a > pi.pos && b < pi.pos + pi.len) {
+    /* cut from the middle of a piece: split it in two */
+    if (ed->piece_count == ed->piece_cap) { return; }
+    insert_pieces(ed, i + 1, 1);
+    set_piece(ed, &ed->pieces[i], pi.add, pi.start, a - pi.pos);
+    set_piece(ed, &ed->pieces[i + 1], pi.add, pi.start + b - pi.pos, pi.pos + pi.len - b);
+  } else {
+    /* keep the head of piece i and the tail of piece j, drop the rest */
+    mu_Piece keep[2];
+    int n = 0;
+    if (a > pi.pos) {
+      set_piece(ed, &keep[n++], pi.add, pi.start, a - pi.pos);
+    }
+    if (b < pj.pos + pj.len) {
+      set_piece(ed, &keep[n++], pj.add, pj.start + b - pj.pos, pj.pos + pj.len - b);
+    }
+    memmove(ed->pieces + i + n, ed->pieces + j + 1,
+      (ed->piece_count - j - 1) * sizeof(mu_Piece));
+    memcpy(ed->pieces + i, keep, n * sizeof(mu_Piece));
+    ed->piece_count += n - (j - i + 1);
+  }
+  update_pieces(ed, i);
+
+  if (ed->cursor > b) {
+    ed->cursor -= b - a;
+  } else if (ed->cursor > a) {
+    ed->cursor = a;
+  }
+}
+
+
+int mu_editor_line_start(mu_Editor *ed, int line) {
+  int lo = 0, hi = ed->piece_count - 1, n;
+  const int *nl;
+  mu_Piece *p;
+  if (line <= 0) { return 0; }
+  if (line > ed->lines) { return ed->len; }
+  /* the last piece starting before the line's '\n' holds it */
+  while (lo < hi) {
+    int mid = (lo + hi + 1) / 2;
+    if (ed->pieces[mid].line < line) { lo = mid; } else { hi = mid - 1; }
+  }
+  p = &ed->pieces[lo];
+  nl = p->add ? ed->add_nl : ed->orig_nl;
+  n = p->add ? ed->add_nl_count : ed->orig_nl_count;
+  n = lower_bound(nl, n, p->start) + (line - p->line - 1);
+  return p->pos + nl[n] - p->start + 1;
+}
+
+
+int mu_editor_line_of(mu_Editor *ed, int pos) {
+  mu_Piece *p;
+  if (ed->piece_count == 0) { return 0; }
+  pos = mu_clamp(pos, 0, ed->len);
+  p = &ed->pieces[find_piece(ed, pos)];
+  return p->line + count_newlines(ed, p->add, p->start, p->start + pos - p->pos);
+}
+
+
+int mu_editor_read(mu_Editor *ed, int pos, char *dst, int len) {
+  int i, n = 0;
+  pos = mu_clamp(pos, 0, ed->len);
+  len = mu_min(len, ed->len - pos);
+  i = find_piece(ed, pos);
+  while (n < len) {
+    mu_Piece *p = &ed->pieces[i++];
+    int off = pos + n - p->pos;
+    int m = mu_min(p->len - off, len - n);
+    memcpy(dst + n, buffer_text(ed, p->add) + p->start + off, m);
+    n += m;
+  }
+  return n;
+}
+
+
+/*============================================================================
+** control
+**============================================================================*/
+
+static int prev_char(mu_Editor *ed, int pos) {
+  if (pos > 0) { while (--pos > 0 && (byte_at(ed, pos) & 0xc0) == 0x80); }
+  return pos;
+}
+
+
+static int next_char(mu_Editor *ed, int pos) {
+  if (pos < ed->len) { while (++pos < ed->len && (byte_at(ed, pos) & 0xc0) == 0x80); }
+  return pos;
+}
+
+
+static int line_end(mu_Editor *ed, int line) {
+  return line < ed->lines ? mu_editor_line_start(ed, line + 1) - 1 : ed->len;
+}
+
+
+/* pixel offset of `pos` from `start`, the start of its line */
+static int text_x(mu_Context *ctx, mu_Editor *ed, int start, int pos) {
+  int x = 0;
+  while (start < pos) {
+    const char *text;
+    int n = get_run(ed, start, pos, &text);
+    x += ctx->text_width(ctx->style->font, text, n);
+    start += n;
+  }
+  return x;
+}
+
+
+/* character boundary of `line` nearest to the pixel offset `x` */
+static int text_hit(mu_Context *ctx, mu_Editor *ed, int line, int x) {
+  mu_Font font = ctx->style->font;
+  int pos = mu_editor_line_start(ed, line), end = line_end(ed, line);
+  int cx = 0;
+  while (pos < end) {
+    const char *text;
+    int i, n = get_run(ed, pos, end, &text);
+    int w = ctx->text_width(font, text, n);
+    if (cx + w <= x) { cx += w; pos += n; continue; }
+    for (i = 0; i < n;) {
+      int j = i + 1;
+      while (j < n && (text[j] & 0xc0) == 0x80) { j++; }
+      w = ctx->text_width(font, text + i, j - i);
+      if (x < cx + w / 2) { break; }
+      cx += w;
+      i = j;
+    }
+    return pos + i;
+  }
+  return end;
+}
+
+
+/* applies the frame's events in the order they arrived */
+static int handle_input(mu_Context *ctx, mu_Editor *ed, int page) {
+  int res = 0, n;
+  mu_Event *ev = NULL;
+
+  while (mu_next_event(ctx, &ev)) {
+    int pos = ed->cursor, vertical = 0, change = 0;
+    int line = mu_editor_line_of(ed, pos);
+    int key = ev->type == MU_EVENT_KEYDOWN ? ev->key : 0;
+
+    /* handle text input */
+    if (ev->type == MU_EVENT_TEXT) {
+      pos += mu_editor_insert(ed, pos, ev->text, strlen(ev->text));
+      change = 1;
+    }
+    if (key == MU_KEY_RETURN) {
+      pos += mu_editor_insert(ed, pos, "\n", 1);
+      change = 1;
+    }
+    if (key == MU_KEY_BACKSPACE && pos > 0) {
+      n = prev_char(ed, pos);
+      mu_editor_delete(ed, n, pos - n);
+      pos = n;
+      change = 1;
+    }
+    if (key == MU_KEY_DELETE && pos < ed->len) {
+      mu_editor_delete(ed, pos, next_char(ed, pos) - pos);
+      change = 1;
+    }
+
+    /* handle cursor movement */
+    if (key == MU_KEY_LEFT)  { pos = prev_char(ed, pos); }
+    if (key == MU_KEY_RIGHT) { pos = next_char(ed, pos); }
+    if (key == MU_KEY_HOME)  { pos = mu_editor_line_start(ed, line); }
+    if (key == MU_KEY_END)   { pos = line_end(ed, line); }
+    if (key & (MU_KEY_UP | MU_KEY_DOWN | MU_KEY_PAGEUP | MU_KEY_PAGEDOWN)) {
+      if (key == MU_KEY_UP)       { line -= 1; }
+      if (key == MU_KEY_DOWN)     { line += 1; }
+      if (key == MU_KEY_PAGEUP)   { line -= page; }
+      if (key == MU_KEY_PAGEDOWN) { line += page; }
+      line = mu_clamp(line, 0, ed->lines);
+      pos = text_hit(ctx, ed, line, ed->target_x);
+      vertical = 1;
+    }
+
+    if (pos != ed->cursor || change) {
+      ed->cursor = pos;
+      ed->follow = 1;
+      if (!vertical) {
+        line = mu_editor_line_of(ed, pos);
+        ed->target_x = text_x(ctx, ed, mu_editor_line_start(ed, line), pos);
+      }
+    }
+    if (change) { res |= MU_RES_CHANGE; }
+  }
+  return res;
+}
+
+
+/* cursor rect relative to the start of the document */
+static mu_Rect cursor_rect(mu_Context *ctx, mu_Editor *ed, int lineh) {
+  int line = mu_editor_line_of(ed, ed->cursor);
+  int x = text_x(ctx, ed, mu_editor_line_start(ed, line), ed->cursor);
+  return mu_rect(x, line * lineh, 1, lineh);
+}
+
+
+int mu_editor(mu_Context *ctx, mu_Editor *ed, int opt) {
+  int res = 0, line, first, last, start;
+  mu_Font font = ctx->style->font;
+  mu_Color color = ctx->style->colors[MU_COLOR_TEXT];
+  int lineh = ctx->text_height(font);
+  mu_Id id = mu_get_id(ctx, &ed, sizeof(ed));
+  mu_Container *cnt;
+  mu_Rect doc, clip;
+
+  mu_push_id(ctx, &ed, sizeof(ed));
+  cnt = mu_get_container(ctx, "!editor");
+
+  /* handle keyboard input before the panel so that scrolling the cursor into
+  ** view takes effect this frame */
+  if (ctx->focus == id) {
+    mu_Rect b = expand_rect(cnt->body, -ctx->style->padding);
+    res |= handle_input(ctx, ed, mu_max(b.h / lineh - 1, 1));
+    if (ed->follow) {
+      mu_Rect r = cursor_rect(ctx, ed, lineh);
+      cnt->scroll.x = mu_clamp(cnt->scroll.x, r.x + r.w - b.w, r.x);
+      cnt->scroll.y = mu_clamp(cnt->scroll.y, r.y + r.h - b.h, r.y);
+      ed->max_width = mu_max(ed->max_width, r.x + r.w);
+      ed->follow = 0;
+    }
+  }
+
+  mu_begin_panel_ex(ctx, "!editor", opt);
+
+  /* reserve the document's size so the panel scrolls over it */
+  mu_layout_set_next(ctx, mu_rect(0, 0, ed->max_width + 1, (ed->lines + 1) * lineh), 1);
+  doc = mu_layout_next(ctx);
+  mu_update_control(ctx, id, cnt->body, MU_OPT_HOLDFOCUS);
+
+  /* handle mouse */
+  if (ctx->focus == id && ctx->mouse_down & MU_MOUSE_LEFT) {
+    line = mu_clamp((ctx->mouse_pos.y - doc.y) / lineh, 0, ed->lines);
+    ed->target_x = ctx->mouse_pos.x - doc.x;
+    ed->cursor = text_hit(ctx, ed, line, ed->target_x);
+  }
+
+  /* draw the visible lines */
+  if (ed->width_font != font) {
+    drop_widths(ed, 0, 1);
+    ed->width_font = font;
+  }
+  clip = mu_get_clip_rect(ctx);
+  first = mu_clamp((clip.y - doc.y) / lineh, 0, ed->lines);
+  last = mu_clamp((clip.y + clip.h - doc.y) / lineh, 0, ed->lines);
+  start = mu_editor_line_start(ed, first);
+  for (line = first; line <= last; line++) {
+    int end = line_end(ed, line), pos = start;
+    mu_LineWidth *lw = &ed->widths[line % MU_EDITOR_WIDTHCACHE_SIZE];
+    int known = lw->line == line;
+    mu_Vec2 p = mu_vec2(doc.x, doc.y + line * lineh);
+    /* runs are measured up to the right of the clip rect to place them, and
+    ** to its end the first time to learn the line's width; only runs
+    ** overlapping the clip rect are drawn */
+    while (pos < end && !(known && p.x >= clip.x + clip.w)) {
+      const char *text;
+      int n = get_run(ed, pos, end, &text);
+      int w = known && n == end - start ? lw->width : ctx->text_width(font, text, n);
+      if (p.x + w > clip.x && p.x < clip.x + clip.w) {
+        mu_draw_text(ctx, font, text, n, p, color);
+      }
+      p.x += w;
+      pos += n;
+    }
+    if (!known) {
+      lw->line = line;
+      lw->width = p.x - doc.x;
+    }
+    ed->max_width = mu_max(ed->max_width, lw->width);
+    start = end + 1;
+  }
+
+  /* draw cursor */
+  if (ctx->focus == id) {
+    mu_Rect r = cursor_rect(ctx, ed, lineh);
+    mu_draw_rect(ctx, mu_rect(doc.x + r.x, doc.y + r.y, r.w, r.h), color);
+  }
+
+  mu_end_panel(ctx);
+  mu_pop_id(ctx);
+  return res;
+}
@@ -0,0 +1,67 @@
+/*
+** Copyright (c) 2020 rxi
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the MIT license. See `microui.c` for details.
+*/
+
+#ifndef MICROUI_EDITOR_H
+#define MICROUI_EDITOR_H
+
+#include "microui.h"
+
+/* bytes measured or drawn per text command when walking a line */
+#define MU_EDITOR_RUNSIZE 256
+/* lines whose width is remembered between frames, by line number */
+#define MU_EDITOR_WIDTHCACHE_SIZE 128
+
+typedef struct {
+  int add;        /* 0: piece of the original text, 1: of the add buffer */
+  int start, len; /* byte range in its buffer */
+  int lines;      /* number of '\n' in the piece */
+  int pos;        /* document offset of the piece */
+  int line;       /* number of '\n' before the piece */
+} mu_Piece;
+
+typedef struct { int line, width; } mu_LineWidth;
+
+typedef struct {
+  /* original text, never modified; `orig_nl` holds its '\n' offsets */
+  const char *orig;
+  int orig_len;
+  int *orig_nl;
+  int orig_nl_count, orig_nl_cap;
+  /* append-only buffer of inserted text and its '\n' offsets */
+  char *add;
+  int add_len, add_cap;
+  int *add_nl;
+  int add_nl_count, add_nl_cap;
+  /* piece table */
+  mu_Piece *pieces;
+  int piece_count, piece_cap;
+  int len, lines;
+  /* view state */
+  int cursor;
+  int target_x;   /* x the cursor returns to when moving up and down */
+  int max_width;  /* widest line drawn so far */
+  int follow;     /* scroll the cursor into view */
+  /* widths of lines drawn before, at `line % MU_EDITOR_WIDTHCACHE_SIZE`;
+  ** an entry is dropped when its line is edited or moved */
+  mu_LineWidth widths[MU_EDITOR_WIDTHCACHE_SIZE];
+  mu_Font width_font;
+} mu_Editor;
+
+/* the caller owns all memory: set `orig_nl`/`orig_nl_cap`, `add`/`add_cap`,
+** `add_nl`/`add_nl_cap` and `pieces`/`piece_cap` before calling
+** mu_editor_init(). `text` is cut short before the first '\n' which does
+** not fit in `orig_nl`, and the length kept is returned. Edits which do not
+** fit in the remaining capacity are truncated */
+int mu_editor_init(mu_Editor *ed, const char *text, int len);
+int mu_editor_insert(mu_Editor *ed, int pos, const char *text, int len);
+void mu_editor_delete(mu_Editor *ed, int pos, int len);
+int mu_editor_line_start(mu_Editor *ed, int line);
+int mu_editor_line_of(mu_Editor *ed, int pos);
+int mu_editor_read(mu_Editor *ed, int pos, char *dst, int len);
+int mu_editor(mu_Context *ctx, mu_Editor *ed, int opt);
+
+#endif
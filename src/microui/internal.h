@@ -0,0 +1,32 @@
+/*
+** Copyright (c) 2020 rxi
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the MIT license. See `microui.c` for details.
+*/
+
+/* helpers shared by the library's source files; not part of the API */
+
+#ifndef MICROUI_INTERNAL_H
+#define MICROUI_INTERNAL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "microui.h"
+
+#define unused(x) ((void) (x))
+
+#define expect(x) do {                                               \
+    if (!(x)) {                                                      \
+      fprintf(stderr, "Fatal error: %s:%d: assertion '%s' failed\n", \
+        __FILE__, __LINE__, #x);                                     \
+      abort();                                                       \
+    }                                                                \
+  } while (0)
+
+
+static mu_Rect expand_rect(mu_Rect rect, int n) {
+  return mu_rect(rect.x - n, rect.y - n, rect.w + n * 2, rect.h + n * 2);
+}
+
+#endif
@@ -20,20 +20,11 @@
 ** IN THE SOFTWARE.
 */
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "microui.h"
-
-#define unused(x) ((void) (x))
-
-#define expect(x) do {                                               \
-    if (!(x)) {                                                      \
-      fprintf(stderr, "Fatal error: %s:%d: assertion '%s' failed\n", \
-        __FILE__, __LINE__, #x);                                     \
-      abort();                                                       \
-    }                                                                \
-  } while (0)
+#include "internal.h"
 
 #define push(stk, val) do {                                                 \
     expect((stk).idx < (int) (sizeof((stk).items) / sizeof(*(stk).items))); \
@@ -99,11 +90,6 @@ mu_Color mu_color(int r, int g, int b, int a) {
 }
 
 
-static mu_Rect expand_rect(mu_Rect rect, int n) {
-  return mu_rect(rect.x - n, rect.y - n, rect.w + n * 2, rect.h + n * 2);
-}
-
-
 static mu_Rect intersect_rects(mu_Rect r1, mu_Rect r2) {
   int x1 = mu_max(r1.x, r2.x);
   int y1 = mu_max(r1.y, r2.y);
@@ -115,41 +101,260 @@ static mu_Rect intersect_rects(mu_Rect r1, mu_Rect r2) {
 }
 
 
+static int rect_equal(mu_Rect r, mu_Rect r2) {
+  return r.x == r2.x && r.y == r2.y && r.w == r2.w && r.h == r2.h;
+}
+
+
 static int rect_overlaps_vec2(mu_Rect r, mu_Vec2 p) {
   return p.x >= r.x && p.x < r.x + r.w && p.y >= r.y && p.y < r.y + r.h;
 }
 
 
+#ifdef MU_ID64
+/* 64bit fnv-1a hash */
+#define HASH_INITIAL 14695981039346656037ULL
+#define HASH_PRIME   1099511628211ULL
+#else
+/* 32bit fnv-1a hash */
+#define HASH_INITIAL 2166136261
+#define HASH_PRIME   16777619
+#endif
+
+static void hash(mu_Id *hash, const void *data, int size) {
+  const unsigned char *p = data;
+  while (size--) {
+    *hash = (*hash ^ *p++) * HASH_PRIME;
+  }
+}
+
+
 static void draw_frame(mu_Context *ctx, mu_Rect rect, int colorid) {
   mu_draw_rect(ctx, rect, ctx->style->colors[colorid]);
-  if (colorid == MU_COLOR_SCROLLBASE  ||
-      colorid == MU_COLOR_SCROLLTHUMB ||
-      colorid == MU_COLOR_TITLEBG) { return; }
   /* draw border */
-  if (ctx->style->colors[MU_COLOR_BORDER].a) {
+  if (ctx->frame_borders & (1 << colorid)) {
     mu_draw_box(ctx, expand_rect(rect, 1), ctx->style->colors[MU_COLOR_BORDER]);
   }
 }
 
 
-void mu_init(mu_Context *ctx) {
+static void update_frame_borders(mu_Context *ctx) {
+  ctx->frame_borders = 0;
+  if (ctx->style->colors[MU_COLOR_BORDER].a) {
+    ctx->frame_borders = ~((1 << MU_COLOR_SCROLLBASE) |
+      (1 << MU_COLOR_SCROLLTHUMB) | (1 << MU_COLOR_TITLEBG));
+  }
+}
+
+
+static mu_Id style_hash(mu_Style *style) {
+  mu_Id res = HASH_INITIAL;
+  hash(&res, style, sizeof(mu_Style));
+  return res;
+}
+
+
+/* bumps `style_version` and recomputes what is derived from the style.
+** mu_begin() and mu_end() call it when the style differs from when it was
+** last called, so it is only needed for a change to take effect from the
+** next control drawn rather than from the next frame */
+void mu_style_changed(mu_Context *ctx) {
+  ctx->style_version++;
+  ctx->style_hash = style_hash(ctx->style);
+  update_frame_borders(ctx);
+}
+
+
+static void check_style(mu_Context *ctx) {
+  if (style_hash(ctx->style) != ctx->style_hash) { mu_style_changed(ctx); }
+}
+
+
+/* initialises `ctx` to use the given storage for its stacks and pools, and
+** buffers for its command list and segment arena; all must outlive the
+** context and the buffers be aligned as a pointer */
+void mu_init_ex(mu_Context *ctx, mu_ContextStorage *cold,
+  char *commands, int commands_size, char *segments, int segments_size)
+{
+  expect(((size_t) commands | (size_t) segments) % sizeof(void*) == 0);
+#ifdef MU_EXTERNAL_STORAGE
   memset(ctx, 0, sizeof(*ctx));
+#else
+  memset(ctx, 0, offsetof(mu_Context, storage));
+#endif
+  memset(cold, 0, sizeof(*cold));
   ctx->draw_frame = draw_frame;
   ctx->_style = default_style;
   ctx->style = &ctx->_style;
+  ctx->cold = cold;
+  ctx->command_list.items = commands;
+  ctx->command_list.size = commands_size;
+  ctx->segment_arena.items = segments;
+  ctx->segment_arena.size = segments_size;
+  mu_style_changed(ctx);
+}
+
+
+#ifndef MU_EXTERNAL_STORAGE
+void mu_init(mu_Context *ctx) {
+  mu_init_ex(ctx, &ctx->storage, ctx->command_data.items, MU_COMMANDLIST_SIZE,
+    ctx->segment_data.items, MU_SEGMENTARENA_SIZE);
+}
+#endif
+
+
+#ifdef MU_INBOX
+/* the inbox's head (0) or tail (1) index. The context may be allocated
+** with any alignment, so each is placed at the start of a whole cache line
+** found within `lines`, sharing it with nothing else */
+static unsigned* inbox_index(mu_Context *ctx, int i) {
+  unsigned *p = ctx->cold->inbox.lines;
+  int skip = (MU_CACHELINE_SIZE - (size_t) p % MU_CACHELINE_SIZE) % MU_CACHELINE_SIZE;
+  return p + (skip + i * MU_CACHELINE_SIZE) / sizeof(unsigned);
+}
+
+
+/* applies everything posted with mu_post_event() so far */
+static void drain_inbox(mu_Context *ctx) {
+  unsigned tail = *inbox_index(ctx, 1);
+  unsigned head = MU_LOAD_ACQUIRE(inbox_index(ctx, 0));
+  for (; tail != head; tail++) {
+    mu_InboxEvent *e = &ctx->cold->inbox.items[tail & (MU_INBOX_SIZE - 1)];
+    switch (e->type) {
+      case MU_EVENT_MOUSEMOVE: mu_input_mousemove(ctx, e->pos.x, e->pos.y); break;
+      case MU_EVENT_MOUSEDOWN: mu_input_mousedown(ctx, e->pos.x, e->pos.y, e->key); break;
+      case MU_EVENT_MOUSEUP:   mu_input_mouseup(ctx, e->pos.x, e->pos.y, e->key); break;
+      case MU_EVENT_SCROLL:    mu_input_scroll(ctx, e->pos.x, e->pos.y); break;
+      case MU_EVENT_KEYDOWN:   mu_input_keydown(ctx, e->key); break;
+      case MU_EVENT_KEYUP:     mu_input_keyup(ctx, e->key); break;
+      case MU_EVENT_TEXT:      mu_input_text(ctx, e->text); break;
+    }
+  }
+  /* hand the slots back to the producer */
+  MU_STORE_RELEASE(inbox_index(ctx, 1), tail);
 }
+#endif
 
 
 void mu_begin(mu_Context *ctx) {
   expect(ctx->text_width && ctx->text_height);
+#ifdef MU_INBOX
+  drain_inbox(ctx);
+#endif
   ctx->command_list.idx = 0;
-  ctx->root_list.idx = 0;
+  ctx->last_command = -1;
+  ctx->cold->root_list.idx = 0;
+  ctx->last_clip = unclipped_rect;
   ctx->scroll_target = NULL;
   ctx->hover_root = ctx->next_hover_root;
   ctx->next_hover_root = NULL;
   ctx->mouse_delta.x = ctx->mouse_pos.x - ctx->last_mouse_pos.x;
   ctx->mouse_delta.y = ctx->mouse_pos.y - ctx->last_mouse_pos.y;
   ctx->frame++;
+  check_style(ctx);
+  /* drop every segment if the arena filled up last frame */
+  if (ctx->segment_arena.idx == ctx->segment_arena.size) {
+    ctx->segment_arena.idx = 0;
+    ctx->segment_gen++;
+  }
+}
+
+
+static int rect_contains(mu_Rect r, mu_Rect r2) {
+  return r2.x >= r.x && r2.x + r2.w <= r.x + r.w &&
+         r2.y >= r.y && r2.y + r2.h <= r.y + r.h;
+}
+
+
+/* shrinks `r` by the part `cover` hides if what is left is still a rect */
+static mu_Rect trim_rect(mu_Rect r, mu_Rect cover) {
+  int x1 = r.x, y1 = r.y, x2 = r.x + r.w, y2 = r.y + r.h;
+  int cx1 = cover.x, cy1 = cover.y, cx2 = cover.x + cover.w, cy2 = cover.y + cover.h;
+  if (cy1 <= y1 && cy2 >= y2) {
+    if (cx1 <= x1 && cx2 > x1) { x1 = cx2; }
+    else if (cx1 < x2 && cx2 >= x2) { x2 = cx1; }
+  } else if (cx1 <= x1 && cx2 >= x2) {
+    if (cy1 <= y1 && cy2 > y1) { y1 = cy2; }
+    else if (cy1 < y2 && cy2 >= y2) { y2 = cy1; }
+  }
+  return mu_rect(x1, y1, x2 - x1, y2 - y1);
+}
+
+
+/* removes the rects of a batch hidden by `cover`, returning how many are left */
+static int cull_batch(mu_Rect *rects, int count, mu_Rect cover) {
+  int i, n = 0;
+  for (i = 0; i < count; i++) {
+    if (!rect_contains(cover, rects[i])) { rects[n++] = rects[i]; }
+  }
+  return n;
+}
+
+
+/* MU_MODE_CULL: drops the commands of each root container which are hidden
+** under the opaque background of a root above it, and trims the rects which
+** are partly hidden. This rewrites the frame's command list in place, so a
+** walk of it after mu_end() only sees what is left. Segment bodies are only
+** reached through a call, which isn't followed, so a segment replays in full
+** in later frames */
+static void cull_roots(mu_Context *ctx) {
+  int i, j, n = ctx->cold->root_list.idx;
+  for (i = n - 2; i >= 0; i--) {
+    mu_Container *cnt = ctx->cold->root_list.items[i];
+    mu_Command *cmd = (mu_Command*) ((char*) cnt->head + cnt->head->base.size);
+    int first = i + 1;
+    while (first < n && ctx->cold->root_list.items[first]->cover.w == 0) { first++; }
+    if (first == n) { continue; }
+    while (cmd != cnt->tail) {
+      mu_Rect r;
+      int hidden = 0;
+      switch (cmd->type) {
+        case MU_COMMAND_JUMP:
+          /* a root begun inside this one is skipped by its head, which
+          ** end_root_container() pointed past it; the root tails are still
+          ** unset (NULL) until mu_end() links the roots; step over those */
+          if (cmd->jump.dst) { cmd = cmd->jump.dst; continue; }
+          r = mu_rect(0, 0, 0, 0);
+          break;
+        case MU_COMMAND_RECT: r = cmd->rect.rect; break;
+        case MU_COMMAND_BOX:  r = cmd->box.rect; break;
+        case MU_COMMAND_ICON: r = cmd->icon.rect; break;
+        case MU_COMMAND_FRAME: r = expand_rect(cmd->frame.rect, 1); break;
+        case MU_COMMAND_TEXT:
+          r = mu_rect(cmd->text.pos.x, cmd->text.pos.y,
+            cmd->text.width, ctx->text_height(cmd->text.font));
+          break;
+        default: r = mu_rect(0, 0, 0, 0); break;
+      }
+      for (j = first; j < n && !hidden; j++) {
+        mu_Rect cover = ctx->cold->root_list.items[j]->cover;
+        if (cover.w == 0) { continue; }
+        switch (cmd->type) {
+          case MU_COMMAND_RECT_BATCH:
+            cmd->rect_batch.count = cull_batch(cmd->rect_batch.rects, cmd->rect_batch.count, cover);
+            hidden = cmd->rect_batch.count == 0;
+            break;
+          case MU_COMMAND_ICON_BATCH:
+            cmd->icon_batch.count = cull_batch(cmd->icon_batch.rects, cmd->icon_batch.count, cover);
+            hidden = cmd->icon_batch.count == 0;
+            break;
+          case MU_COMMAND_RECT:
+            cmd->rect.rect = r = trim_rect(r, cover);
+            hidden = r.w <= 0 || r.h <= 0;
+            break;
+          default:
+            hidden = r.w > 0 && rect_contains(cover, r);
+            break;
+        }
+      }
+      /* hidden commands become jumps to the next command */
+      if (hidden) {
+        cmd->type = MU_COMMAND_JUMP;
+        cmd->jump.dst = (char*) cmd + cmd->base.size;
+      }
+      cmd = (mu_Command*) ((char*) cmd + cmd->base.size);
+    }
+  }
 }
 
 
@@ -158,13 +363,18 @@ static int compare_zindex(const void *a, const void *b) {
 }
 
 
-void mu_end(mu_Context *ctx) {
-  int i, n;
+/* returns non-zero if the next frame may differ from this one without any
+** new input: input was handled this frame (its effects on controls drawn
+** earlier in the frame only show up in the next), or focus, hover, the
+** hovered root, the z order, the style or a container's content size changed */
+int mu_end(mu_Context *ctx) {
+  int i, n, res;
   /* check stacks */
-  expect(ctx->container_stack.idx == 0);
-  expect(ctx->clip_stack.idx      == 0);
-  expect(ctx->id_stack.idx        == 0);
-  expect(ctx->layout_stack.idx    == 0);
+  expect(ctx->cold->container_stack.idx == 0);
+  expect(ctx->cold->clip_stack.idx      == 0);
+  expect(ctx->cold->id_stack.idx        == 0);
+  expect(ctx->cold->layout_stack.idx    == 0);
+  expect(ctx->cold->style_stack.idx     == 0);
 
   /* handle scroll input */
   if (ctx->scroll_target) {
@@ -184,57 +394,72 @@ void mu_end(mu_Context *ctx) {
     mu_bring_to_front(ctx, ctx->next_hover_root);
   }
 
+  /* check whether another frame is needed before resetting input */
+  check_style(ctx);
+  res = ctx->frame_requested || ctx->cold->events.idx || ctx->mouse_pressed ||
+    ctx->style_version != ctx->prev_style_version ||
+    ctx->key_pressed || ctx->scroll_delta.x || ctx->scroll_delta.y ||
+    ctx->hover != ctx->prev_hover || ctx->focus != ctx->prev_focus ||
+    ctx->last_zindex != ctx->prev_zindex ||
+    ctx->next_hover_root != ctx->hover_root;
+  ctx->frame_requested = 0;
+  ctx->prev_hover = ctx->hover;
+  ctx->prev_focus = ctx->focus;
+  ctx->prev_zindex = ctx->last_zindex;
+  ctx->prev_style_version = ctx->style_version;
+
   /* reset input state */
   ctx->key_pressed = 0;
   ctx->input_text[0] = '\0';
+  ctx->cold->events.idx = 0;
+  ctx->cold->event_text.idx = 0;
   ctx->mouse_pressed = 0;
   ctx->scroll_delta = mu_vec2(0, 0);
   ctx->last_mouse_pos = ctx->mouse_pos;
 
   /* sort root containers by zindex */
-  n = ctx->root_list.idx;
-  qsort(ctx->root_list.items, n, sizeof(mu_Container*), compare_zindex);
+  n = ctx->cold->root_list.idx;
+  qsort(ctx->cold->root_list.items, n, sizeof(mu_Container*), compare_zindex);
+  if (ctx->mode & MU_MODE_CULL) { cull_roots(ctx); }
 
   /* set root container jump commands */
   for (i = 0; i < n; i++) {
-    mu_Container *cnt = ctx->root_list.items[i];
+    mu_Container *cnt = ctx->cold->root_list.items[i];
     /* if this is the first container then make the first command jump to it.
     ** otherwise set the previous container's tail to jump to this one */
     if (i == 0) {
       mu_Command *cmd = (mu_Command*) ctx->command_list.items;
-      cmd->jump.dst = (char*) cnt->head + sizeof(mu_JumpCommand);
+      cmd->jump.dst = (char*) cnt->head + cnt->head->base.size;
     } else {
-      mu_Container *prev = ctx->root_list.items[i - 1];
-      prev->tail->jump.dst = (char*) cnt->head + sizeof(mu_JumpCommand);
+      mu_Container *prev = ctx->cold->root_list.items[i - 1];
+      prev->tail->jump.dst = (char*) cnt->head + cnt->head->base.size;
     }
     /* make the last container's tail jump to the end of command list */
     if (i == n - 1) {
       cnt->tail->jump.dst = ctx->command_list.items + ctx->command_list.idx;
     }
   }
+
+  return res;
 }
 
 
-void mu_set_focus(mu_Context *ctx, mu_Id id) {
-  ctx->focus = id;
-  ctx->updated_focus = 1;
+/* for changes microui can't see, such as animations or data arriving in the
+** background: makes the current (or next) mu_end() report a frame is needed */
+void mu_request_frame(mu_Context *ctx) {
+  ctx->frame_requested = 1;
 }
 
 
-/* 32bit fnv-1a hash */
-#define HASH_INITIAL 2166136261
-
-static void hash(mu_Id *hash, const void *data, int size) {
-  const unsigned char *p = data;
-  while (size--) {
-    *hash = (*hash ^ *p++) * 16777619;
-  }
+void mu_set_focus(mu_Context *ctx, mu_Id id) {
+  ctx->focus = id;
+  ctx->updated_focus = 1;
 }
 
 
 mu_Id mu_get_id(mu_Context *ctx, const void *data, int size) {
-  int idx = ctx->id_stack.idx;
-  mu_Id res = (idx > 0) ? ctx->id_stack.items[idx - 1] : HASH_INITIAL;
+  int idx = ctx->cold->id_stack.idx;
+  mu_Id res = (idx > 0) ? ctx->cold->id_stack.items[idx - 1] : HASH_INITIAL;
   hash(&res, data, size);
   ctx->last_id = res;
   return res;
@@ -242,29 +467,86 @@ mu_Id mu_get_id(mu_Context *ctx, const void *data, int size) {
 
 
 void mu_push_id(mu_Context *ctx, const void *data, int size) {
-  push(ctx->id_stack, mu_get_id(ctx, data, size));
+  push(ctx->cold->id_stack, mu_get_id(ctx, data, size));
 }
 
 
 void mu_pop_id(mu_Context *ctx) {
-  pop(ctx->id_stack);
+  pop(ctx->cold->id_stack);
+}
+
+
+/* style overrides are written to `ctx->style` in place, so controls read
+** them at no extra cost; the stack keeps only the values they replaced,
+** which mu_pop_style() writes back */
+static int* style_int(mu_Style *style, int field) {
+  switch (field) {
+    case MU_STYLE_SIZEX:          return &style->size.x;
+    case MU_STYLE_SIZEY:          return &style->size.y;
+    case MU_STYLE_PADDING:        return &style->padding;
+    case MU_STYLE_SPACING:        return &style->spacing;
+    case MU_STYLE_INDENT:         return &style->indent;
+    case MU_STYLE_TITLEHEIGHT:    return &style->title_height;
+    case MU_STYLE_FOOTERHEIGHT:   return &style->footer_height;
+    case MU_STYLE_SCROLLBARSIZE:  return &style->scrollbar_size;
+    case MU_STYLE_THUMBSIZE:      return &style->thumb_size;
+  }
+  expect(0);
+  return NULL;
+}
+
+
+void mu_push_style_color(mu_Context *ctx, int colorid, mu_Color color) {
+  mu_StyleOverride *o;
+  expect(colorid >= 0 && colorid < MU_COLOR_MAX);
+  expect(ctx->cold->style_stack.idx < MU_STYLESTACK_SIZE);
+  o = &ctx->cold->style_stack.items[ctx->cold->style_stack.idx++];
+  o->field = MU_STYLE_MAX + colorid;
+  o->old.c = ctx->style->colors[colorid];
+  ctx->style->colors[colorid] = color;
+  if (colorid == MU_COLOR_BORDER) { update_frame_borders(ctx); }
+}
+
+
+void mu_push_style_int(mu_Context *ctx, int field, int value) {
+  mu_StyleOverride *o;
+  int *p = style_int(ctx->style, field);
+  expect(ctx->cold->style_stack.idx < MU_STYLESTACK_SIZE);
+  o = &ctx->cold->style_stack.items[ctx->cold->style_stack.idx++];
+  o->field = field;
+  o->old.i = *p;
+  *p = value;
+}
+
+
+void mu_pop_style(mu_Context *ctx, int count) {
+  expect(count <= ctx->cold->style_stack.idx);
+  while (count-- > 0) {
+    mu_StyleOverride *o = &ctx->cold->style_stack.items[--ctx->cold->style_stack.idx];
+    if (o->field >= MU_STYLE_MAX) {
+      ctx->style->colors[o->field - MU_STYLE_MAX] = o->old.c;
+      if (o->field == MU_STYLE_MAX + MU_COLOR_BORDER) { update_frame_borders(ctx); }
+    } else {
+      *style_int(ctx->style, o->field) = o->old.i;
+    }
+  }
 }
 
 
 void mu_push_clip_rect(mu_Context *ctx, mu_Rect rect) {
   mu_Rect last = mu_get_clip_rect(ctx);
-  push(ctx->clip_stack, intersect_rects(rect, last));
+  push(ctx->cold->clip_stack, intersect_rects(rect, last));
 }
 
 
 void mu_pop_clip_rect(mu_Context *ctx) {
-  pop(ctx->clip_stack);
+  pop(ctx->cold->clip_stack);
 }
 
 
 mu_Rect mu_get_clip_rect(mu_Context *ctx) {
-  expect(ctx->clip_stack.idx > 0);
-  return ctx->clip_stack.items[ctx->clip_stack.idx - 1];
+  expect(ctx->cold->clip_stack.idx > 0);
+  return ctx->cold->clip_stack.items[ctx->cold->clip_stack.idx - 1];
 }
 
 
@@ -284,48 +566,56 @@ static void push_layout(mu_Context *ctx, mu_Rect body, mu_Vec2 scroll) {
   memset(&layout, 0, sizeof(layout));
   layout.body = mu_rect(body.x - scroll.x, body.y - scroll.y, body.w, body.h);
   layout.max = mu_vec2(-0x1000000, -0x1000000);
-  push(ctx->layout_stack, layout);
+  push(ctx->cold->layout_stack, layout);
   mu_layout_row(ctx, 1, &width, 0);
 }
 
 
 static mu_Layout* get_layout(mu_Context *ctx) {
-  return &ctx->layout_stack.items[ctx->layout_stack.idx - 1];
+  return &ctx->cold->layout_stack.items[ctx->cold->layout_stack.idx - 1];
 }
 
 
 static void pop_container(mu_Context *ctx) {
   mu_Container *cnt = mu_get_current_container(ctx);
   mu_Layout *layout = get_layout(ctx);
-  cnt->content_size.x = layout->max.x - layout->body.x;
-  cnt->content_size.y = layout->max.y - layout->body.y;
+  /* undo style overrides left pushed inside the container */
+  if (ctx->cold->style_stack.idx > cnt->style_depth) {
+    mu_pop_style(ctx, ctx->cold->style_stack.idx - cnt->style_depth);
+  }
+  mu_Vec2 cs = mu_vec2(layout->max.x - layout->body.x, layout->max.y - layout->body.y);
+  /* scrollbars and auto-sizing use the content size next frame */
+  if (cs.x != cnt->content_size.x || cs.y != cnt->content_size.y) {
+    ctx->frame_requested = 1;
+  }
+  cnt->content_size = cs;
   /* pop container, layout and id */
-  pop(ctx->container_stack);
-  pop(ctx->layout_stack);
+  pop(ctx->cold->container_stack);
+  pop(ctx->cold->layout_stack);
   mu_pop_id(ctx);
 }
 
 
 mu_Container* mu_get_current_container(mu_Context *ctx) {
-  expect(ctx->container_stack.idx > 0);
-  return ctx->container_stack.items[ ctx->container_stack.idx - 1 ];
+  expect(ctx->cold->container_stack.idx > 0);
+  return ctx->cold->container_stack.items[ ctx->cold->container_stack.idx - 1 ];
 }
 
 
 static mu_Container* get_container(mu_Context *ctx, mu_Id id, int opt) {
   mu_Container *cnt;
   /* try to get existing container from pool */
-  int idx = mu_pool_get(ctx, ctx->container_pool, MU_CONTAINERPOOL_SIZE, id);
+  int idx = mu_pool_get(ctx, ctx->cold->container_pool, MU_CONTAINERPOOL_SIZE, id);
   if (idx >= 0) {
-    if (ctx->containers[idx].open || ~opt & MU_OPT_CLOSED) {
-      mu_pool_update(ctx, ctx->container_pool, idx);
+    if (ctx->cold->containers[idx].open || ~opt & MU_OPT_CLOSED) {
+      mu_pool_update(ctx, ctx->cold->container_pool, idx);
     }
-    return &ctx->containers[idx];
+    return &ctx->cold->containers[idx];
   }
   if (opt & MU_OPT_CLOSED) { return NULL; }
   /* container not found in pool: init new container */
-  idx = mu_pool_init(ctx, ctx->container_pool, MU_CONTAINERPOOL_SIZE, id);
-  cnt = &ctx->containers[idx];
+  idx = mu_pool_init(ctx, ctx->cold->container_pool, MU_CONTAINERPOOL_SIZE, id);
+  cnt = &ctx->cold->containers[idx];
   memset(cnt, 0, sizeof(*cnt));
   cnt->open = 1;
   mu_bring_to_front(ctx, cnt);
@@ -374,7 +664,50 @@ int mu_pool_get(mu_Context *ctx, mu_PoolItem *items, int len, mu_Id id) {
 
 
 void mu_pool_update(mu_Context *ctx, mu_PoolItem *items, int idx) {
-  items[idx].last_update = ctx->frame;
+  mu_PoolItem *item = &items[idx];
+  /* note items first touched this frame while a cached panel is recorded;
+  ** the count is kept past the end of the stack so overflow can be seen */
+  if (ctx->recording && item->last_update != ctx->frame) {
+    if (ctx->cold->pool_refs.idx < MU_POOLREFSTACK_SIZE) {
+      ctx->cold->pool_refs.items[ctx->cold->pool_refs.idx].item = item;
+      ctx->cold->pool_refs.items[ctx->cold->pool_refs.idx].id = item->id;
+    }
+    ctx->cold->pool_refs.idx++;
+  }
+  item->last_update = ctx->frame;
+}
+
+
+/* returns `size` bytes of state kept for `id` for as long as it is requested
+** every frame (or the pool has room); the state is zeroed when first created.
+** States are kept in pools of MU_STATEPOOL_SIZE slots of 16, 64 and 256 bytes
+** and evicted least recently used first, like containers. A slot used this
+** frame is never taken, as a control may still hold a pointer to it; if every
+** slot of the size was used this frame NULL is returned */
+void* mu_get_state(mu_Context *ctx, mu_Id id, int size) {
+  static const int base[] = { 0, MU_STATEPOOL_SIZE, MU_STATEPOOL_SIZE * 5 };
+  mu_PoolItem *items;
+  mu_StateSlot *slot;
+  int c = 0, i, idx;
+  expect(size > 0 && size <= (int) sizeof(mu_StateSlot) * 16);
+  while ((int) sizeof(mu_StateSlot) << (c * 2) < size) { c++; }
+  items = ctx->cold->state_pool[c];
+  idx = mu_pool_get(ctx, items, MU_STATEPOOL_SIZE, id);
+  if (idx >= 0) {
+    mu_pool_update(ctx, items, idx);
+    return &ctx->cold->state_data[base[c] + (idx << (c * 2))];
+  }
+  idx = -1;
+  for (i = 0; i < MU_STATEPOOL_SIZE; i++) {
+    if (items[i].last_update < ctx->frame &&
+        (idx < 0 || items[i].last_update < items[idx].last_update)) { idx = i; }
+  }
+  if (idx < 0) { return NULL; }
+  items[idx].id = id;
+  mu_pool_update(ctx, items, idx);
+  slot = &ctx->cold->state_data[base[c] + (idx << (c * 2))];
+  memset(slot, 0, sizeof(mu_StateSlot) << (c * 2));
+  return slot;
 }
 
 
@@ -382,58 +715,164 @@ void mu_pool_update(mu_Context *ctx, mu_PoolItem *items, int idx) {
 ** input handlers
 **============================================================================*/
 
+static mu_Event* push_event(mu_Context *ctx, int type) {
+  mu_Event *ev;
+  /* drop events which do not fit rather than failing */
+  if (ctx->cold->events.idx == MU_EVENTQUEUE_SIZE) { return NULL; }
+  ev = &ctx->cold->events.items[ctx->cold->events.idx++];
+  ev->type = type;
+  ev->key = 0;
+  ev->mods = ctx->key_down;
+  ev->pos = ctx->mouse_pos;
+  ev->text = NULL;
+  return ev;
+}
+
+
+/* copies as much of `text` as fits in `size` bytes (including the NUL),
+** cutting it at a character boundary; returns the number of bytes copied */
+static int copy_text(char *dst, const char *text, int size) {
+  int n = strlen(text);
+  if (n > size - 1) {
+    n = mu_max(size - 1, 0);
+    while (n > 0 && (text[n] & 0xc0) == 0x80) { n--; }
+  }
+  memcpy(dst, text, n);
+  if (size > 0) { dst[n] = '\0'; }
+  return n;
+}
+
+
 void mu_input_mousemove(mu_Context *ctx, int x, int y) {
+  mu_Event *last = ctx->cold->events.idx ? &ctx->cold->events.items[ctx->cold->events.idx - 1] : NULL;
+  if (ctx->mouse_pos.x == x && ctx->mouse_pos.y == y) { return; }
   ctx->mouse_pos = mu_vec2(x, y);
+  if (ctx->mode & MU_MODE_COALESCEMOTION && last && last->type == MU_EVENT_MOUSEMOVE) {
+    last->pos = ctx->mouse_pos;
+    return;
+  }
+  push_event(ctx, MU_EVENT_MOUSEMOVE);
 }
 
 
 void mu_input_mousedown(mu_Context *ctx, int x, int y, int btn) {
+  mu_Event *ev;
   mu_input_mousemove(ctx, x, y);
   ctx->mouse_down |= btn;
   ctx->mouse_pressed |= btn;
+  if ((ev = push_event(ctx, MU_EVENT_MOUSEDOWN))) { ev->key = btn; }
 }
 
 
 void mu_input_mouseup(mu_Context *ctx, int x, int y, int btn) {
+  mu_Event *ev;
   mu_input_mousemove(ctx, x, y);
   ctx->mouse_down &= ~btn;
+  if ((ev = push_event(ctx, MU_EVENT_MOUSEUP))) { ev->key = btn; }
 }
 
 
 void mu_input_scroll(mu_Context *ctx, int x, int y) {
+  mu_Event *ev;
   ctx->scroll_delta.x += x;
   ctx->scroll_delta.y += y;
+  if ((ev = push_event(ctx, MU_EVENT_SCROLL))) { ev->pos = mu_vec2(x, y); }
 }
 
 
 void mu_input_keydown(mu_Context *ctx, int key) {
+  mu_Event *ev;
   ctx->key_pressed |= key;
   ctx->key_down |= key;
+  if ((ev = push_event(ctx, MU_EVENT_KEYDOWN))) { ev->key = key; }
 }
 
 
 void mu_input_keyup(mu_Context *ctx, int key) {
+  mu_Event *ev;
   ctx->key_down &= ~key;
+  if ((ev = push_event(ctx, MU_EVENT_KEYUP))) { ev->key = key; }
 }
 
 
 void mu_input_text(mu_Context *ctx, const char *text) {
+  mu_Event *ev;
   int len = strlen(ctx->input_text);
-  int size = strlen(text) + 1;
-  expect(len + size <= (int) sizeof(ctx->input_text));
-  memcpy(ctx->input_text + len, text, size);
+  int room = MU_EVENTTEXT_SIZE - ctx->cold->event_text.idx;
+  /* `input_text` only keeps what fits, the event queue has the rest */
+  copy_text(ctx->input_text + len, text, sizeof(ctx->input_text) - len);
+  if (room > 1 && (ev = push_event(ctx, MU_EVENT_TEXT))) {
+    ev->text = ctx->cold->event_text.items + ctx->cold->event_text.idx;
+    ctx->cold->event_text.idx += copy_text(ctx->cold->event_text.items + ctx->cold->event_text.idx, text, room) + 1;
+  }
+}
+
+
+int mu_next_event(mu_Context *ctx, mu_Event **ev) {
+  mu_Event *end = ctx->cold->events.items + ctx->cold->events.idx;
+  *ev = *ev ? *ev + 1 : ctx->cold->events.items;
+  return *ev < end;
 }
 
 
+#ifdef MU_INBOX
+/* bytes of `text` which fit in one inbox event without splitting a UTF-8
+** sequence */
+static int text_chunk(const char *text) {
+  int n = strlen(text);
+  if (n < MU_INBOXTEXT_SIZE) { return n; }
+  n = MU_INBOXTEXT_SIZE - 1;
+  while (n > 0 && (text[n] & 0xc0) == 0x80) { n--; }
+  return n > 0 ? n : MU_INBOXTEXT_SIZE - 1;
+}
+
+
+/* queues `ev` to be applied by the next mu_begin(); may be called from one
+** other thread while the context is in use, and never blocks. Returns 0 and
+** drops the event if the inbox is full. Long text is split over several
+** inbox slots and is queued whole or not at all */
+int mu_post_event(mu_Context *ctx, const mu_Event *ev) {
+  unsigned head = *inbox_index(ctx, 0);
+  unsigned tail = MU_LOAD_ACQUIRE(inbox_index(ctx, 1));
+  const char *text = ev->type == MU_EVENT_TEXT ? ev->text : "";
+  int n, count = 1;
+  for (n = text_chunk(text); text[n]; n += text_chunk(text + n)) { count++; }
+  if (MU_INBOX_SIZE - (head - tail) < (unsigned) count) { return 0; }
+  do {
+    mu_InboxEvent *e = &ctx->cold->inbox.items[head++ & (MU_INBOX_SIZE - 1)];
+    e->type = ev->type;
+    e->key = ev->key;
+    e->pos = ev->pos;
+    n = text_chunk(text);
+    memcpy(e->text, text, n);
+    e->text[n] = '\0';
+    text += n;
+  } while (*text);
+  /* publish the slots written above */
+  MU_STORE_RELEASE(inbox_index(ctx, 0), head);
+  return 1;
+}
+#endif
+
+
 /*============================================================================
 ** commandlist
 **============================================================================*/
 
+/* commands are padded so that each starts MU_COMMAND_ALIGN aligned and can
+** be read in place */
+static int align_size(int size) {
+  return (size + MU_COMMAND_ALIGN - 1) & ~(MU_COMMAND_ALIGN - 1);
+}
+
+
 mu_Command* mu_push_command(mu_Context *ctx, int type, int size) {
   mu_Command *cmd = (mu_Command*) (ctx->command_list.items + ctx->command_list.idx);
-  expect(ctx->command_list.idx + size < MU_COMMANDLIST_SIZE);
+  size = align_size(size);
+  expect(ctx->command_list.idx + size < ctx->command_list.size);
   cmd->base.type = type;
   cmd->base.size = size;
+  ctx->last_command = ctx->command_list.idx;
   ctx->command_list.idx += size;
   return cmd;
 }
@@ -446,13 +885,233 @@ int mu_next_command(mu_Context *ctx, mu_Command **cmd) {
     *cmd = (mu_Command*) ctx->command_list.items;
   }
   while ((char*) *cmd != ctx->command_list.items + ctx->command_list.idx) {
-    if ((*cmd)->type != MU_COMMAND_JUMP) { return 1; }
-    *cmd = (*cmd)->jump.dst;
+    switch ((*cmd)->type) {
+      case MU_COMMAND_JUMP:
+      case MU_COMMAND_CALL:
+      case MU_COMMAND_RET:
+        *cmd = (*cmd)->jump.dst;
+        break;
+      default:
+        /* the list is walked in order, so fetch a few cache lines ahead */
+        MU_PREFETCH((char*) *cmd + 256);
+        return 1;
+    }
   }
   return 0;
 }
 
 
+/* finds the next run of commands which follow each other in the list in
+** drawing order, following jumps, calls and returns like mu_next_command().
+** `*p` is NULL to start from the beginning */
+static int next_span(mu_Context *ctx, char **p, mu_Span *span) {
+  char *end = ctx->command_list.items + ctx->command_list.idx;
+  char *start = NULL;
+  if (!*p) { *p = ctx->command_list.items; }
+  for (;;) {
+    mu_Command *cmd = (mu_Command*) *p;
+    if (*p == end || cmd->type == MU_COMMAND_JUMP ||
+        cmd->type == MU_COMMAND_CALL || cmd->type == MU_COMMAND_RET
+    ) {
+      if (start) {
+        span->cmd = (mu_Command*) start;
+        span->len = *p - start;
+        return 1;
+      }
+      if (*p == end) { return 0; }
+    }
+    switch (cmd->type) {
+      case MU_COMMAND_JUMP:
+      case MU_COMMAND_CALL:
+      case MU_COMMAND_RET:
+        *p = cmd->jump.dst;
+        break;
+      default:
+        if (!start) { start = *p; }
+        *p += cmd->base.size;
+        break;
+    }
+  }
+}
+
+
+/* fills `spans` with the runs of commands to draw in order, each of which
+** can be walked by adding the commands' sizes. Returns the number of spans,
+** which can be more than `max` */
+int mu_get_spans(mu_Context *ctx, mu_Span *spans, int max) {
+  char *p = NULL;
+  mu_Span span;
+  int n = 0;
+  while (next_span(ctx, &p, &span)) {
+    if (n < max) { spans[n] = span; }
+    n++;
+  }
+  return n;
+}
+
+
+/* copies the commands to draw into `dst` in drawing order, so they can be
+** walked without jumps. Returns the number of bytes written, or 0 if they
+** don't fit in `size` bytes */
+int mu_linearize(mu_Context *ctx, char *dst, int size) {
+  char *p = NULL;
+  mu_Span span;
+  int n = 0;
+  while (next_span(ctx, &p, &span)) {
+    if (n + span.len > size) { return 0; }
+    memcpy(dst + n, span.cmd, span.len);
+    n += span.len;
+  }
+  return n;
+}
+
+
+/* MU_MODE_LAZYCLIP: rather than resetting the clip rect after every
+** partially clipped item, a clip command is only pushed when the clip rect
+** last set would clip `rect` differently than the current one */
+static void lazy_clip(mu_Context *ctx, mu_Rect rect) {
+  mu_Rect cr = mu_get_clip_rect(ctx);
+  if (!rect_equal(intersect_rects(ctx->last_clip, rect), intersect_rects(cr, rect))) {
+    mu_set_clip(ctx, cr);
+  }
+}
+
+
+/* roots and segments are run out of the order they were pushed in, so each
+** starts and ends with the clip rect unset */
+static void reset_clip(mu_Context *ctx) {
+  if ((ctx->mode & MU_MODE_LAZYCLIP) && !rect_equal(ctx->last_clip, unclipped_rect)) {
+    mu_set_clip(ctx, unclipped_rect);
+  }
+}
+
+
+/* a segment records the commands drawn between mu_begin_segment() and
+** mu_end_segment() into the context's segment arena, where they are kept
+** across frames and replayed by mu_call_segment() for the cost of a single
+** command. A segment's space is reused when it is recorded again and fits;
+** when the arena fills up it is emptied at the next mu_begin(), which
+** invalidates every segment.
+**
+** A segment ends with a return, a jump back to where it was last called
+** from, so walking the commands needs no call stack and writes nothing. For
+** that each segment is called at most once per frame (mu_call_segment()
+** copies its commands for any further calls) and never from another
+** segment: segments called while one is recorded are copied into it */
+void mu_begin_segment(mu_Context *ctx, mu_Segment *seg) {
+  reset_clip(ctx);
+  seg->start = ctx->command_list.idx + 1;
+  ctx->last_command = -1;
+}
+
+
+/* bytes of the segment starting at `cmd` before its return */
+static int segment_body(char *cmd) {
+  char *p = cmd;
+  while (((mu_Command*) p)->type != MU_COMMAND_RET) { p += ((mu_Command*) p)->base.size; }
+  return p - cmd;
+}
+
+
+/* copies the commands [p, end) to `dst` with the body of each segment called
+** in place of the call; returns the bytes written, or only counts them if
+** `dst` is NULL. Returns -1 if a root was begun in the range, as roots leave
+** jumps which only work this frame */
+static int copy_recorded(char *dst, char *p, char *end) {
+  char *run = p;
+  int n = 0;
+  for (;;) {
+    mu_Command *cmd = (mu_Command*) p;
+    if (p == end || cmd->type == MU_COMMAND_CALL) {
+      int len;
+      if (dst) { memcpy(dst + n, run, p - run); }
+      n += p - run;
+      if (p == end) { return n; }
+      len = segment_body(cmd->jump.dst);
+      if (dst) { memcpy(dst + n, cmd->jump.dst, len); }
+      n += len;
+      p = run = p + cmd->base.size;
+      continue;
+    }
+    if (cmd->type == MU_COMMAND_JUMP) { return -1; }
+    p += cmd->base.size;
+  }
+}
+
+
+/* stores the segment being recorded followed by `extra_size` bytes of
+** `extra`, which start MU_COMMAND_ALIGN aligned after its return */
+static int end_segment(mu_Context *ctx, mu_Segment *seg, const void *extra,
+  int extra_size)
+{
+  char *start = ctx->command_list.items + seg->start - 1;
+  char *end;
+  int len, size, cap;
+  mu_Command *cmd;
+  expect(seg->start);
+  reset_clip(ctx);
+  ctx->last_command = -1;
+  end = ctx->command_list.items + ctx->command_list.idx;
+  seg->start = 0;
+  seg->size = 0;
+  len = copy_recorded(NULL, start, end);
+  if (len < 0) { return 0; }
+  size = len + align_size(sizeof(mu_JumpCommand));
+  cap = align_size(size + extra_size);
+  if (seg->gen != ctx->segment_gen || cap > seg->cap) {
+    if (ctx->segment_arena.idx + cap > ctx->segment_arena.size) {
+      /* mark the arena as full; segments called this frame must stay valid */
+      ctx->segment_arena.idx = ctx->segment_arena.size;
+      return 0;
+    }
+    seg->offset = ctx->segment_arena.idx;
+    seg->cap = cap;
+    seg->gen = ctx->segment_gen;
+    ctx->segment_arena.idx += cap;
+  }
+  copy_recorded(ctx->segment_arena.items + seg->offset, start, end);
+  cmd = (mu_Command*) (ctx->segment_arena.items + seg->offset + len);
+  cmd->base.type = MU_COMMAND_RET;
+  cmd->base.size = align_size(sizeof(mu_JumpCommand));
+  cmd->jump.dst = NULL;
+  if (extra_size) { memcpy(ctx->segment_arena.items + seg->offset + size, extra, extra_size); }
+  seg->size = size;
+  seg->frame = 0;
+  return 1;
+}
+
+
+int mu_end_segment(mu_Context *ctx, mu_Segment *seg) {
+  return end_segment(ctx, seg, NULL, 0);
+}
+
+
+int mu_segment_valid(mu_Context *ctx, mu_Segment *seg) {
+  return seg->size > 0 && seg->gen == ctx->segment_gen;
+}
+
+
+void mu_call_segment(mu_Context *ctx, mu_Segment *seg) {
+  char *body = ctx->segment_arena.items + seg->offset;
+  int len = seg->size - align_size(sizeof(mu_JumpCommand));
+  mu_Command *cmd, *ret = (mu_Command*) (body + len);
+  expect(mu_segment_valid(ctx, seg));
+  reset_clip(ctx);
+  if (seg->frame == ctx->frame) {
+    /* its return already leads back to an earlier call this frame */
+    expect(ctx->command_list.idx + len < ctx->command_list.size);
+    memcpy(ctx->command_list.items + ctx->command_list.idx, body, len);
+    ctx->command_list.idx += len;
+    ctx->last_command = -1;
+    return;
+  }
+  seg->frame = ctx->frame;
+  cmd = mu_push_command(ctx, MU_COMMAND_CALL, sizeof(mu_JumpCommand));
+  cmd->jump.dst = body;
+  ret->jump.dst = ctx->command_list.items + ctx->command_list.idx;
+}
+
+
 static mu_Command* push_jump(mu_Context *ctx, mu_Command *dst) {
   mu_Command *cmd;
   cmd = mu_push_command(ctx, MU_COMMAND_JUMP, sizeof(mu_JumpCommand));
@@ -465,6 +1124,38 @@ void mu_set_clip(mu_Context *ctx, mu_Rect rect) {
   mu_Command *cmd;
   cmd = mu_push_command(ctx, MU_COMMAND_CLIP, sizeof(mu_ClipCommand));
   cmd->clip.rect = rect;
+  ctx->last_clip = rect;
+}
+
+
+/* MU_MODE_COALESCE: returns the last command pushed if it is of `type` and
+** may still be merged with the next */
+static mu_Command* last_command(mu_Context *ctx, int type) {
+  mu_Command *cmd;
+  if (ctx->last_command < 0) { return NULL; }
+  cmd = (mu_Command*) (ctx->command_list.items + ctx->last_command);
+  return cmd->type == type ? cmd : NULL;
+}
+
+
+static int color_equal(mu_Color a, mu_Color b) {
+  return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+
+/* grows `r` to cover `r2` if the two share a whole edge */
+static int merge_rects(mu_Rect *r, mu_Rect r2) {
+  if (r->y == r2.y && r->h == r2.h && (r->x + r->w == r2.x || r2.x + r2.w == r->x)) {
+    r->x = mu_min(r->x, r2.x);
+    r->w += r2.w;
+    return 1;
+  }
+  if (r->x == r2.x && r->w == r2.w && (r->y + r->h == r2.y || r2.y + r2.h == r->y)) {
+    r->y = mu_min(r->y, r2.y);
+    r->h += r2.h;
+    return 1;
+  }
+  return 0;
 }
 
 
@@ -472,6 +1163,13 @@ void mu_draw_rect(mu_Context *ctx, mu_Rect rect, mu_Color color) {
   mu_Command *cmd;
   rect = intersect_rects(rect, mu_get_clip_rect(ctx));
   if (rect.w > 0 && rect.h > 0) {
+    if (ctx->mode & MU_MODE_LAZYCLIP) { lazy_clip(ctx, rect); }
+    if (ctx->mode & MU_MODE_COALESCE) {
+      cmd = last_command(ctx, MU_COMMAND_RECT);
+      if (cmd && color_equal(cmd->rect.color, color) && merge_rects(&cmd->rect.rect, rect)) {
+        return;
+      }
+    }
     cmd = mu_push_command(ctx, MU_COMMAND_RECT, sizeof(mu_RectCommand));
     cmd->rect.rect = rect;
     cmd->rect.color = color;
@@ -480,6 +1178,36 @@ void mu_draw_rect(mu_Context *ctx, mu_Rect rect, mu_Color color) {
 
 
 void mu_draw_box(mu_Context *ctx, mu_Rect rect, mu_Color color) {
+  mu_Command *cmd;
+  if (ctx->mode & MU_MODE_COALESCE) {
+    /* a box around the rect just drawn turns it into a frame, if the clip
+    ** rect set already lets the whole box through */
+    cmd = last_command(ctx, MU_COMMAND_RECT);
+    if (cmd && rect_equal(cmd->rect.rect, expand_rect(rect, -1)) &&
+        rect_contains(ctx->last_clip, rect) && !mu_check_clip(ctx, rect)
+    ) {
+      /* the frame command starts with the rect command's fields */
+      int size = align_size(sizeof(mu_FrameCommand));
+      expect(ctx->command_list.idx - cmd->base.size + size < ctx->command_list.size);
+      ctx->command_list.idx += size - cmd->base.size;
+      cmd->base.type = MU_COMMAND_FRAME;
+      cmd->base.size = size;
+      cmd->frame.border = color;
+      return;
+    }
+  }
+  if (ctx->mode & MU_MODE_BATCH) {
+    /* a single box command is only usable if no strip needs clipping */
+    int clipped = mu_check_clip(ctx, rect);
+    if (clipped == MU_CLIP_ALL) { return; }
+    if (!clipped) {
+      if (ctx->mode & MU_MODE_LAZYCLIP) { lazy_clip(ctx, rect); }
+      cmd = mu_push_command(ctx, MU_COMMAND_BOX, sizeof(mu_BoxCommand));
+      cmd->box.rect = rect;
+      cmd->box.color = color;
+      return;
+    }
+  }
   mu_draw_rect(ctx, mu_rect(rect.x + 1, rect.y, rect.w - 2, 1), color);
   mu_draw_rect(ctx, mu_rect(rect.x + 1, rect.y + rect.h - 1, rect.w - 2, 1), color);
   mu_draw_rect(ctx, mu_rect(rect.x, rect.y, 1, rect.h), color);
@@ -495,6 +1223,7 @@ void mu_draw_text(mu_Context *ctx, mu_Font font, const char *str, int len,
     pos.x, pos.y, ctx->text_width(font, str, len), ctx->text_height(font));
   int clipped = mu_check_clip(ctx, rect);
   if (clipped == MU_CLIP_ALL ) { return; }
+  if (ctx->mode & MU_MODE_LAZYCLIP) { lazy_clip(ctx, rect); clipped = 0; }
   if (clipped == MU_CLIP_PART) { mu_set_clip(ctx, mu_get_clip_rect(ctx)); }
   /* add command */
   if (len < 0) { len = strlen(str); }
@@ -504,6 +1233,7 @@ void mu_draw_text(mu_Context *ctx, mu_Font font, const char *str, int len,
   cmd->text.pos = pos;
   cmd->text.color = color;
   cmd->text.font = font;
+  cmd->text.width = rect.w;
   /* reset clipping if it was set */
   if (clipped) { mu_set_clip(ctx, unclipped_rect); }
 }
@@ -514,6 +1244,7 @@ void mu_draw_icon(mu_Context *ctx, int id, mu_Rect rect, mu_Color color) {
   /* do clip command if the rect isn't fully contained within the cliprect */
   int clipped = mu_check_clip(ctx, rect);
   if (clipped == MU_CLIP_ALL ) { return; }
+  if (ctx->mode & MU_MODE_LAZYCLIP) { lazy_clip(ctx, rect); clipped = 0; }
   if (clipped == MU_CLIP_PART) { mu_set_clip(ctx, mu_get_clip_rect(ctx)); }
   /* do icon command */
   cmd = mu_push_command(ctx, MU_COMMAND_ICON, sizeof(mu_IconCommand));
@@ -525,6 +1256,88 @@ void mu_draw_icon(mu_Context *ctx, int id, mu_Rect rect, mu_Color color) {
 }
 
 
+static mu_Command* push_batch(mu_Context *ctx, int type, int size, int count) {
+  return mu_push_command(ctx, type, size + (count - 1) * sizeof(mu_Rect));
+}
+
+
+static void trim_batch(mu_Context *ctx, mu_Command *cmd, int size, int n) {
+  /* shrink the batch to the `n` rects actually written; it is always the
+  ** last command in the list so this simply gives back the unused bytes */
+  int diff = cmd->base.size - align_size(size + (n - 1) * sizeof(mu_Rect));
+  if (n == 0) { diff = cmd->base.size; ctx->last_command = -1; }
+  cmd->base.size -= diff;
+  ctx->command_list.idx -= diff;
+}
+
+
+void mu_draw_rects(mu_Context *ctx, const mu_Rect *rects, int count,
+  mu_Color color)
+{
+  mu_Command *cmd;
+  mu_Rect clip = mu_get_clip_rect(ctx);
+  int i, n = 0;
+  if (count <= 0) { return; }
+  if (~ctx->mode & MU_MODE_BATCH) {
+    for (i = 0; i < count; i++) { mu_draw_rect(ctx, rects[i], color); }
+    return;
+  }
+  if (ctx->mode & MU_MODE_LAZYCLIP) { lazy_clip(ctx, clip); }
+  cmd = push_batch(ctx, MU_COMMAND_RECT_BATCH, sizeof(mu_RectBatchCommand), count);
+  cmd->rect_batch.color = color;
+  for (i = 0; i < count; i++) {
+    mu_Rect r = intersect_rects(rects[i], clip);
+    if (r.w > 0 && r.h > 0) { cmd->rect_batch.rects[n++] = r; }
+  }
+  cmd->rect_batch.count = n;
+  trim_batch(ctx, cmd, sizeof(mu_RectBatchCommand), n);
+}
+
+
+void mu_draw_icons(mu_Context *ctx, int id, const mu_Rect *rects, int count,
+  mu_Color color)
+{
+  mu_Command *cmd;
+  int i, n = 0, clipped = 0;
+  if (count <= 0) { return; }
+  if (~ctx->mode & MU_MODE_BATCH) {
+    for (i = 0; i < count; i++) { mu_draw_icon(ctx, id, rects[i], color); }
+    return;
+  }
+  /* the whole batch shares one clip command if any of its icons need it */
+  for (i = 0; i < count; i++) {
+    int c = mu_check_clip(ctx, rects[i]);
+    if (c == MU_CLIP_PART) { clipped = 1; }
+    if (c != MU_CLIP_ALL) { n++; }
+  }
+  if (n == 0) { return; }
+  if (ctx->mode & MU_MODE_LAZYCLIP) {
+    /* the clip rect only has to suit the bounds of the batch */
+    int x1 = rects[0].x, y1 = rects[0].y;
+    int x2 = rects[0].x + rects[0].w, y2 = rects[0].y + rects[0].h;
+    for (i = 1; i < count; i++) {
+      x1 = mu_min(x1, rects[i].x);
+      y1 = mu_min(y1, rects[i].y);
+      x2 = mu_max(x2, rects[i].x + rects[i].w);
+      y2 = mu_max(y2, rects[i].y + rects[i].h);
+    }
+    lazy_clip(ctx, mu_rect(x1, y1, x2 - x1, y2 - y1));
+    clipped = 0;
+  }
+  if (clipped) { mu_set_clip(ctx, mu_get_clip_rect(ctx)); }
+  cmd = push_batch(ctx, MU_COMMAND_ICON_BATCH, sizeof(mu_IconBatchCommand), n);
+  cmd->icon_batch.id = id;
+  cmd->icon_batch.color = color;
+  cmd->icon_batch.count = n;
+  for (i = n = 0; i < count; i++) {
+    if (mu_check_clip(ctx, rects[i]) != MU_CLIP_ALL) {
+      cmd->icon_batch.rects[n++] = rects[i];
+    }
+  }
+  if (clipped) { mu_set_clip(ctx, unclipped_rect); }
+}
+
+
 /*============================================================================
 ** layout
 **============================================================================*/
@@ -540,7 +1353,7 @@ void mu_layout_begin_column(mu_Context *ctx) {
 void mu_layout_end_column(mu_Context *ctx) {
   mu_Layout *a, *b;
   b = get_layout(ctx);
-  pop(ctx->layout_stack);
+  pop(ctx->cold->layout_stack);
   /* inherit position/next_row/max from child layout if they are greater */
   a = get_layout(ctx);
   a->position.x = mu_max(a->position.x, b->position.x + b->body.x - a->body.x);
@@ -634,12 +1447,12 @@ mu_Rect mu_layout_next(mu_Context *ctx) {
 **============================================================================*/
 
 static int in_hover_root(mu_Context *ctx) {
-  int i = ctx->container_stack.idx;
+  int i = ctx->cold->container_stack.idx;
   while (i--) {
-    if (ctx->container_stack.items[i] == ctx->hover_root) { return 1; }
+    if (ctx->cold->container_stack.items[i] == ctx->hover_root) { return 1; }
     /* only root containers have their `head` field set; stop searching if we've
     ** reached the current root container */
-    if (ctx->container_stack.items[i]->head) { break; }
+    if (ctx->cold->container_stack.items[i]->head) { break; }
   }
   return 0;
 }
@@ -674,6 +1487,37 @@ void mu_draw_control_text(mu_Context *ctx, const char *str, mu_Rect rect,
 }
 
 
+#ifdef MU_DEBUG_IDS
+static void check_id(mu_Context *ctx, mu_Id id, mu_Rect rect) {
+  /* open addressed set of the ids claimed this frame; slots from older frames
+  ** count as empty so the set never needs clearing. A control claiming the
+  ** same id twice (e.g. the slider's number textbox) does so with the same
+  ** rect, two different controls hashing to one id will not */
+  int i;
+  unsigned h = (unsigned) (id ^ (id >> 16));
+  for (i = 0; i < MU_IDCHECK_SIZE; i++) {
+    int n = (h + i) % MU_IDCHECK_SIZE;
+    if (ctx->cold->id_check[n].frame != ctx->frame) {
+      ctx->cold->id_check[n].id = id;
+      ctx->cold->id_check[n].frame = ctx->frame;
+      ctx->cold->id_check[n].rect = rect;
+      return;
+    }
+    if (ctx->cold->id_check[n].id == id) {
+      mu_Rect r = ctx->cold->id_check[n].rect;
+      if (r.x != rect.x || r.y != rect.y || r.w != rect.w || r.h != rect.h) {
+        fprintf(stderr, "Warning: duplicate id %llx at %d,%d and %d,%d\n",
+          (unsigned long long) id, r.x, r.y, rect.x, rect.y);
+        ctx->id_collisions++;
+      }
+      return;
+    }
+  }
+  /* set is full: more controls than MU_IDCHECK_SIZE this frame, skip check */
+}
+#endif
+
+
 int mu_mouse_over(mu_Context *ctx, mu_Rect rect) {
   return rect_overlaps_vec2(rect, ctx->mouse_pos) &&
     rect_overlaps_vec2(mu_get_clip_rect(ctx), ctx->mouse_pos) &&
@@ -684,6 +1528,9 @@ int mu_mouse_over(mu_Context *ctx, mu_Rect rect) {
 void mu_update_control(mu_Context *ctx, mu_Id id, mu_Rect rect, int opt) {
   int mouseover = mu_mouse_over(ctx, rect);
 
+#ifdef MU_DEBUG_IDS
+  check_id(ctx, id, rect);
+#endif
   if (ctx->focus == id) { ctx->updated_focus = 1; }
   if (opt & MU_OPT_NOINTERACT) { return; }
   if (mouseover && !ctx->mouse_down) { ctx->hover = id; }
@@ -774,52 +1621,247 @@ int mu_checkbox(mu_Context *ctx, const char *label, int *state) {
 }
 
 
+static int utf8_prev(const char *buf, int i) {
+  if (i > 0) { while (--i > 0 && (buf[i] & 0xc0) == 0x80); }
+  return i;
+}
+
+
+static int utf8_next(const char *buf, int i) {
+  if (buf[i]) { while ((buf[++i] & 0xc0) == 0x80); }
+  return i;
+}
+
+
+static int is_word_char(int c) {
+  return (c >= '0' && c <= '9') || ((c | 32) >= 'a' && (c | 32) <= 'z') ||
+    c == '_' || c >= 0x80;
+}
+
+
+static int word_prev(const char *buf, int i) {
+  while (i > 0 && !is_word_char((unsigned char) buf[i - 1])) { i--; }
+  while (i > 0 &&  is_word_char((unsigned char) buf[i - 1])) { i--; }
+  return i;
+}
+
+
+static int word_next(const char *buf, int i) {
+  while (buf[i] && !is_word_char((unsigned char) buf[i])) { i++; }
+  while (buf[i] &&  is_word_char((unsigned char) buf[i])) { i++; }
+  return i;
+}
+
+
+/* moves the cursor, measuring only the text it passes over */
+static void textedit_move(mu_Context *ctx, mu_TextEdit *te, const char *buf,
+  int pos)
+{
+  mu_Font font = ctx->style->font;
+  if (pos > te->cursor) {
+    te->cursor_x += ctx->text_width(font, buf + te->cursor, pos - te->cursor);
+  } else if (pos < te->cursor) {
+    te->cursor_x -= ctx->text_width(font, buf + pos, te->cursor - pos);
+  }
+  te->cursor = pos;
+}
+
+
+/* moves the cursor to the character boundary nearest `x`, in pixels from
+** the start of the text */
+static void textedit_move_to_x(mu_Context *ctx, mu_TextEdit *te,
+  const char *buf, int x)
+{
+  mu_Font font = ctx->style->font;
+  while (buf[te->cursor]) {
+    int n = utf8_next(buf, te->cursor);
+    int w = ctx->text_width(font, buf + te->cursor, n - te->cursor);
+    if (x < te->cursor_x + w / 2) { break; }
+    te->cursor = n;
+    te->cursor_x += w;
+  }
+  while (te->cursor > 0) {
+    int p = utf8_prev(buf, te->cursor);
+    int w = ctx->text_width(font, buf + p, te->cursor - p);
+    if (x >= te->cursor_x - w + w / 2) { break; }
+    te->cursor = p;
+    te->cursor_x -= w;
+  }
+}
+
+
+/* replaces the bytes [lo, hi) with `n` bytes of `text`, truncating the
+** inserted text at a character boundary if the buffer is full */
+static void textedit_replace(mu_Context *ctx, mu_TextEdit *te, char *buf,
+  int bufsz, int lo, int hi, const char *text, int n)
+{
+  textedit_move(ctx, te, buf, lo);
+  if (n > bufsz - 1 - (te->len - (hi - lo))) {
+    n = bufsz - 1 - (te->len - (hi - lo));
+    while (n > 0 && (text[n] & 0xc0) == 0x80) { n--; }
+  }
+  memmove(buf + lo + n, buf + hi, te->len - hi + 1);
+  memcpy(buf + lo, text, n);
+  te->len += n - (hi - lo);
+  textedit_move(ctx, te, buf, lo + n);
+  te->anchor = te->cursor;
+}
+
+
+/* applies the frame's events in the order they arrived, stopping after
+** return so that keys typed after submitting are not applied */
+static int textedit_input(mu_Context *ctx, mu_TextEdit *te, char *buf,
+  int bufsz)
+{
+  int res = 0;
+  mu_Event *ev = NULL;
+
+  while (mu_next_event(ctx, &ev)) {
+    int shift = ev->mods & MU_KEY_SHIFT;
+    int word = ev->mods & MU_KEY_CTRL;
+    int lo = mu_min(te->cursor, te->anchor);
+    int hi = mu_max(te->cursor, te->anchor);
+    int pos = te->cursor;
+
+    /* handle text input, replacing the selection */
+    if (ev->type == MU_EVENT_TEXT) {
+      textedit_replace(ctx, te, buf, bufsz, lo, hi, ev->text, strlen(ev->text));
+      res |= MU_RES_CHANGE;
+      continue;
+    }
+    if (ev->type != MU_EVENT_KEYDOWN) { continue; }
+
+    /* handle return */
+    if (ev->key == MU_KEY_RETURN) {
+      mu_set_focus(ctx, 0);
+      return res | MU_RES_SUBMIT;
+    }
+
+    /* handle backspace and delete */
+    if (ev->key & (MU_KEY_BACKSPACE | MU_KEY_DELETE)) {
+      if (lo == hi && ev->key == MU_KEY_BACKSPACE) {
+        lo = word ? word_prev(buf, lo) : utf8_prev(buf, lo);
+      } else if (lo == hi) {
+        hi = word ? word_next(buf, hi) : utf8_next(buf, hi);
+      }
+      if (lo != hi) {
+        textedit_replace(ctx, te, buf, bufsz, lo, hi, "", 0);
+        res |= MU_RES_CHANGE;
+      }
+    }
+
+    /* handle cursor movement; shift extends the selection */
+    if (ev->key & (MU_KEY_LEFT | MU_KEY_RIGHT | MU_KEY_HOME | MU_KEY_END)) {
+      if (ev->key == MU_KEY_LEFT) {
+        pos = (lo != hi && !shift) ? lo : word ? word_prev(buf, pos) : utf8_prev(buf, pos);
+      }
+      if (ev->key == MU_KEY_RIGHT) {
+        pos = (lo != hi && !shift) ? hi : word ? word_next(buf, pos) : utf8_next(buf, pos);
+      }
+      if (ev->key == MU_KEY_HOME) { pos = 0; }
+      if (ev->key == MU_KEY_END) { pos = te->len; }
+      textedit_move(ctx, te, buf, pos);
+      if (!shift) { te->anchor = pos; }
+    }
+  }
+
+  return res;
+}
+
+
 int mu_textbox_raw(mu_Context *ctx, char *buf, int bufsz, mu_Id id, mu_Rect r,
   int opt)
 {
   int res = 0;
+  mu_TextEdit *te = NULL, scratch;
+  mu_Font font = ctx->style->font;
+  int texth = ctx->text_height(font);
+  int texty = r.y + (r.h - texth) / 2;
+  int textx = r.x + ctx->style->padding;
+  int vieww = r.w - ctx->style->padding * 2;
   mu_update_control(ctx, id, r, opt | MU_OPT_HOLDFOCUS);
 
   if (ctx->focus == id) {
-    /* handle text input */
-    int len = strlen(buf);
-    int n = mu_min(bufsz - len - 1, (int) strlen(ctx->input_text));
-    if (n > 0) {
-      memcpy(buf + len, ctx->input_text, n);
-      len += n;
-      buf[len] = '\0';
-      res |= MU_RES_CHANGE;
+    te = mu_get_state(ctx, id, sizeof(mu_TextEdit));
+    if (!te) {
+      /* no slot is free this frame: edit with state lasting only this frame */
+      memset(&scratch, 0, sizeof(scratch));
+      te = &scratch;
     }
-    /* handle backspace */
-    if (ctx->key_pressed & MU_KEY_BACKSPACE && len > 0) {
-      /* skip utf-8 continuation bytes */
-      while ((buf[--len] & 0xc0) == 0x80 && len > 0);
-      buf[len] = '\0';
-      res |= MU_RES_CHANGE;
+    /* init state on gaining focus, or if the buffer's length no longer
+    ** matches the cached one (changed by the caller) */
+    if (te->id != id || te->last_update != ctx->frame - 1 || te->len >= bufsz ||
+        buf[te->len] || (te->len > 0 && !buf[te->len - 1])
+    ) {
+      te->id = id;
+      te->len = strlen(buf);
+      te->cursor = te->cursor_x = te->scroll = 0;
+      if (!(ctx->mouse_pressed & MU_MOUSE_LEFT)) { textedit_move(ctx, te, buf, te->len); }
+      te->anchor = te->cursor;
     }
-    /* handle return */
-    if (ctx->key_pressed & MU_KEY_RETURN) {
-      mu_set_focus(ctx, 0);
-      res |= MU_RES_SUBMIT;
+    te->last_update = ctx->frame;
+
+    /* handle mouse; dragging selects */
+    if (ctx->mouse_down & MU_MOUSE_LEFT) {
+      textedit_move_to_x(ctx, te, buf, ctx->mouse_pos.x - textx + te->scroll);
+      if (ctx->mouse_pressed & MU_MOUSE_LEFT && !(ctx->key_down & MU_KEY_SHIFT)) {
+        te->anchor = te->cursor;
+      }
     }
+
+    /* handle keys and text input */
+    res |= textedit_input(ctx, te, buf, bufsz);
+
+    /* keep the cursor in view */
+    te->scroll = mu_min(te->scroll, te->cursor_x);
+    te->scroll = mu_max(te->scroll, te->cursor_x - vieww + 1);
+    te->scroll = mu_max(te->scroll, 0);
   }
 
   /* draw */
   mu_draw_control_frame(ctx, id, r, MU_COLOR_BASE, opt);
-  if (ctx->focus == id) {
+  if (te && ctx->focus == id) {
+    /* measure and draw only the visible span, walking out from the cursor */
     mu_Color color = ctx->style->colors[MU_COLOR_TEXT];
-    mu_Font font = ctx->style->font;
-    int textw = ctx->text_width(font, buf, -1);
-    int texth = ctx->text_height(font);
-    int ofx = r.w - ctx->style->padding - textw - 1;
-    int textx = r.x + mu_min(ofx, ctx->style->padding);
-    int texty = r.y + (r.h - texth) / 2;
+    int start = te->cursor, sx = te->cursor_x;
+    int end = te->cursor, ex = te->cursor_x;
+    textx -= te->scroll;
+    while (start > 0 && sx > te->scroll) {
+      int p = utf8_prev(buf, start);
+      sx -= ctx->text_width(font, buf + p, start - p);
+      start = p;
+    }
+    while (buf[end] && ex < te->scroll + vieww) {
+      int n = utf8_next(buf, end);
+      ex += ctx->text_width(font, buf + end, n - end);
+      end = n;
+    }
     mu_push_clip_rect(ctx, r);
-    mu_draw_text(ctx, font, buf, -1, mu_vec2(textx, texty), color);
-    mu_draw_rect(ctx, mu_rect(textx + textw, texty, 1, texth), color);
+    if (te->anchor != te->cursor) {
+      int lo = mu_clamp(mu_min(te->cursor, te->anchor), start, end);
+      int hi = mu_clamp(mu_max(te->cursor, te->anchor), start, end);
+      int x = sx + ctx->text_width(font, buf + start, lo - start);
+      int w = ctx->text_width(font, buf + lo, hi - lo);
+      mu_draw_rect(ctx, mu_rect(textx + x, texty, w, texth),
+        ctx->style->colors[MU_COLOR_BUTTONFOCUS]);
+    }
+    mu_draw_text(ctx, font, buf + start, end - start, mu_vec2(textx + sx, texty), color);
+    mu_draw_rect(ctx, mu_rect(textx + te->cursor_x, texty, 1, texth), color);
     mu_pop_clip_rect(ctx);
-  } else {
+  } else if (opt & (MU_OPT_ALIGNCENTER | MU_OPT_ALIGNRIGHT)) {
     mu_draw_control_text(ctx, buf, r, MU_COLOR_TEXT, opt);
+  } else {
+    /* left aligned, so only the start of the text needs measuring */
+    int end = 0, ex = 0;
+    while (buf[end] && ex < vieww) {
+      int n = utf8_next(buf, end);
+      ex += ctx->text_width(font, buf + end, n - end);
+      end = n;
+    }
+    mu_push_clip_rect(ctx, r);
+    mu_draw_text(ctx, font, buf, end, mu_vec2(textx, texty),
+      ctx->style->colors[MU_COLOR_TEXT]);
+    mu_pop_clip_rect(ctx);
   }
 
   return res;
@@ -932,7 +1974,7 @@ static int header(mu_Context *ctx, const char *label, int istreenode, int opt) {
   mu_Rect r;
   int active, expanded;
   mu_Id id = mu_get_id(ctx, label, strlen(label));
-  int idx = mu_pool_get(ctx, ctx->treenode_pool, MU_TREENODEPOOL_SIZE, id);
+  int idx = mu_pool_get(ctx, ctx->cold->treenode_pool, MU_TREENODEPOOL_SIZE, id);
   int width = -1;
   mu_layout_row(ctx, 1, &width, 0);
 
@@ -946,10 +1988,10 @@ static int header(mu_Context *ctx, const char *label, int istreenode, int opt) {
 
   /* update pool ref */
   if (idx >= 0) {
-    if (active) { mu_pool_update(ctx, ctx->treenode_pool, idx); }
-           else { memset(&ctx->treenode_pool[idx], 0, sizeof(mu_PoolItem)); }
+    if (active) { mu_pool_update(ctx, ctx->cold->treenode_pool, idx); }
+           else { memset(&ctx->cold->treenode_pool[idx], 0, sizeof(mu_PoolItem)); }
   } else if (active) {
-    mu_pool_init(ctx, ctx->treenode_pool, MU_TREENODEPOOL_SIZE, id);
+    mu_pool_init(ctx, ctx->cold->treenode_pool, MU_TREENODEPOOL_SIZE, id);
   }
 
   /* draw */
@@ -978,7 +2020,7 @@ int mu_begin_treenode_ex(mu_Context *ctx, const char *label, int opt) {
   int res = header(ctx, label, 1, opt);
   if (res & MU_RES_ACTIVE) {
     get_layout(ctx)->indent += ctx->style->indent;
-    push(ctx->id_stack, ctx->last_id);
+    push(ctx->cold->id_stack, ctx->last_id);
   }
   return res;
 }
@@ -1066,10 +2108,13 @@ static void push_container_body(
 
 
 static void begin_root_container(mu_Context *ctx, mu_Container *cnt) {
-  push(ctx->container_stack, cnt);
+  push(ctx->cold->container_stack, cnt);
+  cnt->style_depth = ctx->cold->style_stack.idx;
   /* push container to roots list and push head command */
-  push(ctx->root_list, cnt);
+  reset_clip(ctx);
+  push(ctx->cold->root_list, cnt);
   cnt->head = push_jump(ctx, NULL);
+  cnt->cover = mu_rect(0, 0, 0, 0);
   /* set as hover root if the mouse is overlapping this container and it has a
   ** higher zindex than the current hover root */
   if (rect_overlaps_vec2(cnt->rect, ctx->mouse_pos) &&
@@ -1080,7 +2125,7 @@ static void begin_root_container(mu_Context *ctx, mu_Container *cnt) {
   /* clipping is reset here in case a root-container is made within
   ** another root-containers's begin/end block; this prevents the inner
   ** root-container being clipped to the outer */
-  push(ctx->clip_stack, unclipped_rect);
+  push(ctx->cold->clip_stack, unclipped_rect);
 }
 
 
@@ -1088,6 +2133,7 @@ static void end_root_container(mu_Context *ctx) {
   /* push tail 'goto' jump command and set head 'skip' command. the final steps
   ** on initing these are done in mu_end() */
   mu_Container *cnt = mu_get_current_container(ctx);
+  reset_clip(ctx);
   cnt->tail = push_jump(ctx, NULL);
   cnt->head->jump.dst = ctx->command_list.items + ctx->command_list.idx;
   /* pop base clip rect and container */
@@ -1101,7 +2147,7 @@ int mu_begin_window_ex(mu_Context *ctx, const char *title, mu_Rect rect, int opt
   mu_Id id = mu_get_id(ctx, title, strlen(title));
   mu_Container *cnt = get_container(ctx, id, opt);
   if (!cnt || !cnt->open) { return 0; }
-  push(ctx->id_stack, id);
+  push(ctx->cold->id_stack, id);
 
   if (cnt->rect.w == 0) { cnt->rect = rect; }
   begin_root_container(ctx, cnt);
@@ -1111,6 +2157,10 @@ int mu_begin_window_ex(mu_Context *ctx, const char *title, mu_Rect rect, int opt
   /* draw frame */
   if (~opt & MU_OPT_NOFRAME) {
     ctx->draw_frame(ctx, rect, MU_COLOR_WINDOWBG);
+    /* only the default frame is known to fill the rect */
+    if (ctx->draw_frame == draw_frame && ctx->style->colors[MU_COLOR_WINDOWBG].a == 255) {
+      cnt->cover = rect;
+    }
   }
 
   /* do title bar */
@@ -1225,13 +2275,96 @@ void mu_begin_panel_ex(mu_Context *ctx, const char *name, int opt) {
   if (~opt & MU_OPT_NOFRAME) {
     ctx->draw_frame(ctx, cnt->rect, MU_COLOR_PANELBG);
   }
-  push(ctx->container_stack, cnt);
+  push(ctx->cold->container_stack, cnt);
+  cnt->style_depth = ctx->cold->style_stack.idx;
   push_container_body(ctx, cnt, cnt->rect, opt);
   mu_push_clip_rect(ctx, cnt->body);
 }
 
 
+/* returns true if the recorded segment can be kept: no control in it may be
+** hovered or focused, as replaying it runs none of them */
+static int panel_cacheable(mu_Context *ctx, mu_Container *cnt) {
+  return !ctx->updated_focus && !mu_mouse_over(ctx, cnt->body);
+}
+
+
+/* like mu_begin_panel_ex(), but if `version` and the panel's body, clip rect,
+** scroll and the style are the same as when it was last drawn, and the mouse
+** isn't over it, the segment recorded that frame is called; mu_begin_panel_cached()
+** then returns 0 and the panel's contents and mu_end_panel() are skipped */
+int mu_begin_panel_cached(mu_Context *ctx, const char *name, int opt, int version) {
+  mu_Container *cnt;
+  mu_PanelCache *pc;
+  mu_Rect clip;
+  mu_Id key = HASH_INITIAL;
+  int i;
+  mu_begin_panel_ex(ctx, name, opt);
+  cnt = mu_get_current_container(ctx);
+  pc = &cnt->cache;
+  clip = mu_get_clip_rect(ctx);
+  hash(&key, &version, sizeof(version));
+  hash(&key, &cnt->body, sizeof(cnt->body));
+  hash(&key, &clip, sizeof(clip));
+  hash(&key, &cnt->scroll, sizeof(cnt->scroll));
+  hash(&key, &ctx->style_version, sizeof(ctx->style_version));
+  for (i = 0; i < ctx->cold->style_stack.idx; i++) {
+    /* overrides in effect, which style_version doesn't cover */
+    int field = ctx->cold->style_stack.items[i].field;
+    hash(&key, &field, sizeof(field));
+    if (field >= MU_STYLE_MAX) {
+      hash(&key, &ctx->style->colors[field - MU_STYLE_MAX], sizeof(mu_Color));
+    } else {
+      hash(&key, style_int(ctx->style, field), sizeof(int));
+    }
+  }
+
+  if (mu_segment_valid(ctx, &pc->seg) && pc->key == key &&
+      !mu_mouse_over(ctx, cnt->body)
+  ) {
+    /* keep the pool items of the controls inside (treenodes, nested
+    ** containers, mu_get_state()) alive as if they had run */
+    mu_PoolRef *refs = (mu_PoolRef*) (ctx->segment_arena.items + pc->seg.offset + pc->seg.size);
+    for (i = 0; i < pc->refs; i++) {
+      if (refs[i].item->id == refs[i].id) { mu_pool_update(ctx, refs[i].item, 0); }
+    }
+    mu_call_segment(ctx, &pc->seg);
+    /* undo mu_begin_panel_ex(), keeping the content size it was recorded with */
+    pop(ctx->cold->clip_stack);
+    pop(ctx->cold->container_stack);
+    pop(ctx->cold->layout_stack);
+    mu_pop_id(ctx);
+    return 0;
+  }
+
+  /* record this frame's commands */
+  pc->key = key;
+  mu_begin_segment(ctx, &pc->seg);
+  pc->updated_focus = ctx->updated_focus;
+  pc->refs = ctx->cold->pool_refs.idx;
+  ctx->updated_focus = 0;
+  ctx->recording++;
+  return MU_RES_ACTIVE;
+}
+
+
 void mu_end_panel(mu_Context *ctx) {
+  mu_Container *cnt = mu_get_current_container(ctx);
+  mu_PanelCache *pc = &cnt->cache;
+  if (pc->seg.start) {
+    /* store the pool items touched inside along with the segment, unless
+    ** there were more than the stack could note */
+    int n = ctx->cold->pool_refs.idx - pc->refs;
+    if (panel_cacheable(ctx, cnt) && ctx->cold->pool_refs.idx <= MU_POOLREFSTACK_SIZE) {
+      end_segment(ctx, &pc->seg, ctx->cold->pool_refs.items + pc->refs, n * sizeof(mu_PoolRef));
+      pc->refs = n;
+    } else {
+      pc->seg.start = 0;
+      pc->seg.size = 0;
+    }
+    ctx->updated_focus |= pc->updated_focus;
+    if (--ctx->recording == 0) { ctx->cold->pool_refs.idx = 0; }
+  }
   mu_pop_clip_rect(ctx);
   pop_container(ctx);
 }
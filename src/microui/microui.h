@@ -11,20 +11,45 @@
 #define MU_VERSION "2.01"
 
 #define MU_COMMANDLIST_SIZE     (256 * 1024)
+#define MU_SEGMENTARENA_SIZE    (64 * 1024)
 #define MU_ROOTLIST_SIZE        32
 #define MU_CONTAINERSTACK_SIZE  32
 #define MU_CLIPSTACK_SIZE       32
 #define MU_IDSTACK_SIZE         32
 #define MU_LAYOUTSTACK_SIZE     16
+#define MU_STYLESTACK_SIZE      64
 #define MU_CONTAINERPOOL_SIZE   48
 #define MU_TREENODEPOOL_SIZE    48
+#define MU_STATEPOOL_SIZE       32
+#define MU_POOLREFSTACK_SIZE    64
 #define MU_MAX_WIDTHS           16
 #define MU_REAL                 float
 #define MU_REAL_FMT             "%.3g"
 #define MU_SLIDER_FMT           "%.2f"
 #define MU_MAX_FMT              127
+#define MU_IDCHECK_SIZE         4096
+#define MU_EVENTQUEUE_SIZE      256
+#define MU_EVENTTEXT_SIZE       4096
+#define MU_INBOX_SIZE           256
+#define MU_INBOXTEXT_SIZE       16
+#define MU_COMMAND_ALIGN        8
+#define MU_CACHELINE_SIZE       64
+
+/* define as eg. __builtin_prefetch to have mu_next_command() prefetch the
+** commands ahead of the one it returns */
+#ifndef MU_PREFETCH
+#define MU_PREFETCH(p)
+#endif
+
+/* acquire load and release store of an unsigned, used by the event inbox
+** (mu_post_event()); define both for compilers without the GNU builtins */
+#ifndef MU_LOAD_ACQUIRE
+#define MU_LOAD_ACQUIRE(p)      __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define MU_STORE_RELEASE(p, v)  __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#endif
 
 #define mu_stack(T, n)          struct { int idx; T items[n]; }
+#define mu_buffer(n)            union { char items[n]; void *p; double d; }
 #define mu_min(a, b)            ((a) < (b) ? (a) : (b))
 #define mu_max(a, b)            ((a) > (b) ? (a) : (b))
 #define mu_clamp(x, a, b)       mu_min(b, mu_max(a, x))
@@ -45,6 +70,12 @@ enum {
   MU_COMMAND_RECT,
   MU_COMMAND_TEXT,
   MU_COMMAND_ICON,
+  MU_COMMAND_BOX,
+  MU_COMMAND_RECT_BATCH,
+  MU_COMMAND_ICON_BATCH,
+  MU_COMMAND_FRAME,
+  MU_COMMAND_CALL,
+  MU_COMMAND_RET,
   MU_COMMAND_MAX
 };
 
@@ -67,6 +98,19 @@ enum {
   MU_COLOR_MAX
 };
 
+enum {
+  MU_STYLE_SIZEX,
+  MU_STYLE_SIZEY,
+  MU_STYLE_PADDING,
+  MU_STYLE_SPACING,
+  MU_STYLE_INDENT,
+  MU_STYLE_TITLEHEIGHT,
+  MU_STYLE_FOOTERHEIGHT,
+  MU_STYLE_SCROLLBARSIZE,
+  MU_STYLE_THUMBSIZE,
+  MU_STYLE_MAX
+};
+
 enum {
   MU_ICON_CLOSE = 1,
   MU_ICON_RESIZE,
@@ -98,6 +142,14 @@ enum {
   MU_OPT_EXPANDED     = (1 << 12)
 };
 
+enum {
+  MU_MODE_BATCH           = (1 << 0),
+  MU_MODE_COALESCEMOTION  = (1 << 1),
+  MU_MODE_LAZYCLIP        = (1 << 2),
+  MU_MODE_CULL            = (1 << 3),
+  MU_MODE_COALESCE        = (1 << 4)
+};
+
 enum {
   MU_MOUSE_LEFT       = (1 << 0),
   MU_MOUSE_RIGHT      = (1 << 1),
@@ -109,12 +161,35 @@ enum {
   MU_KEY_CTRL         = (1 << 1),
   MU_KEY_ALT          = (1 << 2),
   MU_KEY_BACKSPACE    = (1 << 3),
-  MU_KEY_RETURN       = (1 << 4)
+  MU_KEY_RETURN       = (1 << 4),
+  MU_KEY_LEFT         = (1 << 5),
+  MU_KEY_RIGHT        = (1 << 6),
+  MU_KEY_HOME         = (1 << 7),
+  MU_KEY_END          = (1 << 8),
+  MU_KEY_DELETE       = (1 << 9),
+  MU_KEY_UP           = (1 << 10),
+  MU_KEY_DOWN         = (1 << 11),
+  MU_KEY_PAGEUP       = (1 << 12),
+  MU_KEY_PAGEDOWN     = (1 << 13)
+};
+
+enum {
+  MU_EVENT_MOUSEMOVE = 1,
+  MU_EVENT_MOUSEDOWN,
+  MU_EVENT_MOUSEUP,
+  MU_EVENT_SCROLL,
+  MU_EVENT_KEYDOWN,
+  MU_EVENT_KEYUP,
+  MU_EVENT_TEXT
 };
 
 
 typedef struct mu_Context mu_Context;
+#ifdef MU_ID64
+typedef unsigned long long mu_Id;
+#else
 typedef unsigned mu_Id;
+#endif
 typedef MU_REAL mu_Real;
 typedef void* mu_Font;
 
@@ -122,13 +197,33 @@ typedef union { struct { int x, y; }; int data[2]; } mu_Vec2;
 typedef union { struct { int x, y, w, h; }; int data[4];} mu_Rect;
 typedef struct { unsigned char r, g, b, a; } mu_Color;
 typedef struct { mu_Id id; int last_update; } mu_PoolItem;
+typedef struct { mu_PoolItem *item; mu_Id id; } mu_PoolRef;
+typedef union { void *p; double d; long l; char c[16]; } mu_StateSlot;
+
+typedef struct {
+  int type;
+  int key;          /* MU_KEY_... or MU_MOUSE_... of key and button events */
+  int mods;         /* keys held down when the event occurred */
+  mu_Vec2 pos;      /* mouse position, or the amount of a scroll event */
+  const char *text; /* NUL-terminated UTF-8 of text events */
+} mu_Event;
+
+typedef struct {
+  int type, key;
+  mu_Vec2 pos;
+  char text[MU_INBOXTEXT_SIZE];
+} mu_InboxEvent;
 
 typedef struct { int type, size; } mu_BaseCommand;
 typedef struct { mu_BaseCommand base; void *dst; } mu_JumpCommand;
 typedef struct { mu_BaseCommand base; mu_Rect rect; } mu_ClipCommand;
 typedef struct { mu_BaseCommand base; mu_Rect rect; mu_Color color; } mu_RectCommand;
-typedef struct { mu_BaseCommand base; mu_Font font; mu_Vec2 pos; mu_Color color; char str[1]; } mu_TextCommand;
+typedef struct { mu_BaseCommand base; mu_Font font; mu_Vec2 pos; mu_Color color; int width; char str[1]; } mu_TextCommand;
 typedef struct { mu_BaseCommand base; mu_Rect rect; int id; mu_Color color; } mu_IconCommand;
+typedef struct { mu_BaseCommand base; mu_Rect rect; mu_Color color; } mu_BoxCommand;
+typedef struct { mu_BaseCommand base; mu_Color color; int count; mu_Rect rects[1]; } mu_RectBatchCommand;
+typedef struct { mu_BaseCommand base; int id; mu_Color color; int count; mu_Rect rects[1]; } mu_IconBatchCommand;
+typedef struct { mu_BaseCommand base; mu_Rect rect; mu_Color color, border; } mu_FrameCommand;
 
 typedef union {
   int type;
@@ -138,8 +233,19 @@ typedef union {
   mu_RectCommand rect;
   mu_TextCommand text;
   mu_IconCommand icon;
+  mu_BoxCommand box;
+  mu_RectBatchCommand rect_batch;
+  mu_IconBatchCommand icon_batch;
+  mu_FrameCommand frame;
 } mu_Command;
 
+typedef struct { mu_Command *cmd; int len; } mu_Span;
+
+typedef struct {
+  int field;          /* MU_STYLE_..., or MU_STYLE_MAX + colorid for a color */
+  union { int i; mu_Color c; } old;
+} mu_StyleOverride;
+
 typedef struct {
   mu_Rect body;
   mu_Rect next;
@@ -154,6 +260,22 @@ typedef struct {
   int indent;
 } mu_Layout;
 
+typedef struct {
+  int offset, size;   /* location in the segment arena, `size` 0 if unset */
+  int cap;            /* bytes reserved in the arena */
+  int gen;            /* arena generation the segment was stored in */
+  int start;          /* command list offset + 1 while recording */
+  int frame;          /* frame it was last called in */
+} mu_Segment;
+
+typedef struct {
+  mu_Segment seg;
+  mu_Id key;          /* hash of the version and state the segment was drawn with */
+  int updated_focus;  /* ctx->updated_focus when recording started */
+  int refs;           /* pool_refs index when recording started, then the
+                      ** number of mu_PoolRefs stored after the segment */
+} mu_PanelCache;
+
 typedef struct {
   mu_Command *head, *tail;
   mu_Rect rect;
@@ -162,6 +284,9 @@ typedef struct {
   mu_Vec2 scroll;
   int zindex;
   int open;
+  int style_depth;  /* style override stack depth when the container was begun */
+  mu_Rect cover;    /* rect filled with an opaque background this frame */
+  mu_PanelCache cache;
 } mu_Container;
 
 typedef struct {
@@ -177,37 +302,76 @@ typedef struct {
   mu_Color colors[MU_COLOR_MAX];
 } mu_Style;
 
+typedef struct {
+  mu_Id id;
+  int last_update;
+  int len;        /* cached strlen() of the buffer */
+  int cursor;     /* byte offset of the cursor */
+  int anchor;     /* other end of the selection, equal to cursor if none */
+  int cursor_x;   /* pixel offset of the cursor from the start of the text */
+  int scroll;     /* pixels scrolled out on the left */
+} mu_TextEdit;
+
+/* the bulk of a context's state, reached through `mu_Context.cold` so the
+** fields every control touches share a few cache lines; embedded in the
+** context by mu_init(), or given to mu_init_ex() */
+typedef struct {
+  /* stacks */
+  mu_stack(mu_Container*, MU_ROOTLIST_SIZE) root_list;
+  mu_stack(mu_Container*, MU_CONTAINERSTACK_SIZE) container_stack;
+  mu_stack(mu_Rect, MU_CLIPSTACK_SIZE) clip_stack;
+  mu_stack(mu_Id, MU_IDSTACK_SIZE) id_stack;
+  mu_stack(mu_Layout, MU_LAYOUTSTACK_SIZE) layout_stack;
+  mu_stack(mu_StyleOverride, MU_STYLESTACK_SIZE) style_stack;
+  /* input events in the order received, emptied at the end of each frame */
+  mu_stack(mu_Event, MU_EVENTQUEUE_SIZE) events;
+  mu_stack(char, MU_EVENTTEXT_SIZE) event_text;
+#ifdef MU_INBOX
+  /* ring of events posted by another thread, drained by mu_begin(); the
+  ** producer writes only the head index and mu_begin() only the tail, each
+  ** on a cache line of its own within `lines` (see inbox_index()) */
+  struct {
+    unsigned lines[MU_CACHELINE_SIZE * 3 / sizeof(unsigned)];
+    mu_InboxEvent items[MU_INBOX_SIZE];
+  } inbox;
+#endif
+  /* retained state pools */
+  mu_PoolItem container_pool[MU_CONTAINERPOOL_SIZE];
+  mu_Container containers[MU_CONTAINERPOOL_SIZE];
+  mu_PoolItem treenode_pool[MU_TREENODEPOOL_SIZE];
+  /* per-id state of mu_get_state(), in three size classes of 1, 4 and 16 slots */
+  mu_PoolItem state_pool[3][MU_STATEPOOL_SIZE];
+  mu_stack(mu_PoolRef, MU_POOLREFSTACK_SIZE) pool_refs;
+  mu_StateSlot state_data[MU_STATEPOOL_SIZE * (1 + 4 + 16)];
+#ifdef MU_DEBUG_IDS
+  /* duplicate id detection */
+  struct { mu_Id id; int frame; mu_Rect rect; } id_check[MU_IDCHECK_SIZE];
+#endif
+} mu_ContextStorage;
+
 struct mu_Context {
   /* callbacks */
   int (*text_width)(mu_Font font, const char *str, int len);
   int (*text_height)(mu_Font font);
   void (*draw_frame)(mu_Context *ctx, mu_Rect rect, int colorid);
   /* core state */
-  mu_Style _style;
   mu_Style *style;
+  int mode;
   mu_Id hover;
   mu_Id focus;
   mu_Id last_id;
   mu_Rect last_rect;
+  mu_Rect last_clip;  /* clip rect set by the last clip command */
   int last_zindex;
   int updated_focus;
   int frame;
+  int frame_requested;
+  int frame_borders;  /* bit per colorid whose frames draw a border */
+  int style_version;  /* bumped by mu_style_changed() */
   mu_Container *hover_root;
   mu_Container *next_hover_root;
   mu_Container *scroll_target;
-  char number_edit_buf[MU_MAX_FMT];
   mu_Id number_edit;
-  /* stacks */
-  mu_stack(char, MU_COMMANDLIST_SIZE) command_list;
-  mu_stack(mu_Container*, MU_ROOTLIST_SIZE) root_list;
-  mu_stack(mu_Container*, MU_CONTAINERSTACK_SIZE) container_stack;
-  mu_stack(mu_Rect, MU_CLIPSTACK_SIZE) clip_stack;
-  mu_stack(mu_Id, MU_IDSTACK_SIZE) id_stack;
-  mu_stack(mu_Layout, MU_LAYOUTSTACK_SIZE) layout_stack;
-  /* retained state pools */
-  mu_PoolItem container_pool[MU_CONTAINERPOOL_SIZE];
-  mu_Container containers[MU_CONTAINERPOOL_SIZE];
-  mu_PoolItem treenode_pool[MU_TREENODEPOOL_SIZE];
   /* input state */
   mu_Vec2 mouse_pos;
   mu_Vec2 last_mouse_pos;
@@ -218,6 +382,33 @@ struct mu_Context {
   int key_down;
   int key_pressed;
   char input_text[32];
+  /* command list and segment arena, see mu_init_ex() */
+  struct { int idx, size; char *items; } command_list;
+  int last_command;   /* offset of the last command pushed, -1 if it can't be merged into */
+  struct { int idx, size; char *items; } segment_arena;
+  int segment_gen;
+  /* stacks, queues and pools, see mu_ContextStorage */
+  mu_ContextStorage *cold;
+  mu_Style _style;
+  /* the rest is only touched once per frame or by less common controls */
+  mu_Id style_hash;    /* hash of *style when mu_style_changed() was last called */
+  mu_Id prev_hover;
+  mu_Id prev_focus;
+  int prev_zindex;
+  int prev_style_version;
+  /* pool items first touched this frame while cached panels are recorded
+  ** (`recording` of them), for replays to keep them alive */
+  int recording;
+  char number_edit_buf[MU_MAX_FMT];
+#ifdef MU_DEBUG_IDS
+  int id_collisions;
+#endif
+#ifndef MU_EXTERNAL_STORAGE
+  /* storage used by mu_init() */
+  mu_ContextStorage storage;
+  mu_buffer(MU_COMMANDLIST_SIZE) command_data;
+  mu_buffer(MU_SEGMENTARENA_SIZE) segment_data;
+#endif
 };
 
 
@@ -226,12 +417,19 @@ mu_Rect mu_rect(int x, int y, int w, int h);
 mu_Color mu_color(int r, int g, int b, int a);
 
 void mu_init(mu_Context *ctx);
+void mu_init_ex(mu_Context *ctx, mu_ContextStorage *cold,
+  char *commands, int commands_size, char *segments, int segments_size);
 void mu_begin(mu_Context *ctx);
-void mu_end(mu_Context *ctx);
+int mu_end(mu_Context *ctx);
+void mu_request_frame(mu_Context *ctx);
 void mu_set_focus(mu_Context *ctx, mu_Id id);
 mu_Id mu_get_id(mu_Context *ctx, const void *data, int size);
 void mu_push_id(mu_Context *ctx, const void *data, int size);
 void mu_pop_id(mu_Context *ctx);
+void mu_push_style_color(mu_Context *ctx, int colorid, mu_Color color);
+void mu_push_style_int(mu_Context *ctx, int field, int value);
+void mu_pop_style(mu_Context *ctx, int count);
+void mu_style_changed(mu_Context *ctx);
 void mu_push_clip_rect(mu_Context *ctx, mu_Rect rect);
 void mu_pop_clip_rect(mu_Context *ctx);
 mu_Rect mu_get_clip_rect(mu_Context *ctx);
@@ -243,6 +441,7 @@ void mu_bring_to_front(mu_Context *ctx, mu_Container *cnt);
 int mu_pool_init(mu_Context *ctx, mu_PoolItem *items, int len, mu_Id id);
 int mu_pool_get(mu_Context *ctx, mu_PoolItem *items, int len, mu_Id id);
 void mu_pool_update(mu_Context *ctx, mu_PoolItem *items, int idx);
+void* mu_get_state(mu_Context *ctx, mu_Id id, int size);
 
 void mu_input_mousemove(mu_Context *ctx, int x, int y);
 void mu_input_mousedown(mu_Context *ctx, int x, int y, int btn);
@@ -251,14 +450,26 @@ void mu_input_scroll(mu_Context *ctx, int x, int y);
 void mu_input_keydown(mu_Context *ctx, int key);
 void mu_input_keyup(mu_Context *ctx, int key);
 void mu_input_text(mu_Context *ctx, const char *text);
+int mu_next_event(mu_Context *ctx, mu_Event **ev);
+#ifdef MU_INBOX
+int mu_post_event(mu_Context *ctx, const mu_Event *ev);
+#endif
 
 mu_Command* mu_push_command(mu_Context *ctx, int type, int size);
 int mu_next_command(mu_Context *ctx, mu_Command **cmd);
+int mu_get_spans(mu_Context *ctx, mu_Span *spans, int max);
+int mu_linearize(mu_Context *ctx, char *dst, int size);
+void mu_begin_segment(mu_Context *ctx, mu_Segment *seg);
+int mu_end_segment(mu_Context *ctx, mu_Segment *seg);
+int mu_segment_valid(mu_Context *ctx, mu_Segment *seg);
+void mu_call_segment(mu_Context *ctx, mu_Segment *seg);
 void mu_set_clip(mu_Context *ctx, mu_Rect rect);
 void mu_draw_rect(mu_Context *ctx, mu_Rect rect, mu_Color color);
 void mu_draw_box(mu_Context *ctx, mu_Rect rect, mu_Color color);
 void mu_draw_text(mu_Context *ctx, mu_Font font, const char *str, int len, mu_Vec2 pos, mu_Color color);
 void mu_draw_icon(mu_Context *ctx, int id, mu_Rect rect, mu_Color color);
+void mu_draw_rects(mu_Context *ctx, const mu_Rect *rects, int count, mu_Color color);
+void mu_draw_icons(mu_Context *ctx, int id, const mu_Rect *rects, int count, mu_Color color);
 
 void mu_layout_row(mu_Context *ctx, int items, const int *widths, int height);
 void mu_layout_width(mu_Context *ctx, int width);
@@ -299,6 +510,7 @@ void mu_open_popup(mu_Context *ctx, const char *name);
 int mu_begin_popup(mu_Context *ctx, const char *name);
 void mu_end_popup(mu_Context *ctx);
 void mu_begin_panel_ex(mu_Context *ctx, const char *name, int opt);
+int mu_begin_panel_cached(mu_Context *ctx, const char *name, int opt, int version);
 void mu_end_panel(mu_Context *ctx);
 
 #endif
@@ -0,0 +1,51 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "microui/microui.h"
+
+/* counts and reports a failed check without stopping the test */
+#define check(x) do {                                          \
+    if (!(x)) {                                                \
+      fprintf(stderr, "%s:%d: check failed: %s\n",            \
+        __FILE__, __LINE__, #x);                               \
+      test_failures++;                                         \
+    }                                                          \
+  } while (0)
+
+static int test_failures;
+
+
+/* fixed width metrics, so the tests need no font */
+static int test_text_width(mu_Font font, const char *text, int len) {
+  (void) font;
+  if (len == -1) { len = strlen(text); }
+  return len * 7;
+}
+
+
+static int test_text_height(mu_Font font) {
+  (void) font;
+  return 18;
+}
+
+
+static mu_Context* test_context(int mode) {
+  mu_Context *ctx = malloc(sizeof(mu_Context));
+  if (!ctx) { abort(); }
+  mu_init(ctx);
+  ctx->text_width = test_text_width;
+  ctx->text_height = test_text_height;
+  ctx->mode = mode;
+  return ctx;
+}
+
+
+static int test_result(const char *name) {
+  printf("%s: %s\n", name, test_failures ? "FAILED" : "ok");
+  return test_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif
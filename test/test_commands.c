@@ -0,0 +1,295 @@
+/*
+** The command list: walking it with mu_next_command(), mu_get_spans() and
+** mu_linearize(), command alignment, retained segments, and the pixels
+** drawn by swrender.c with and without MU_MODE_CULL and MU_MODE_COALESCE.
+*/
+
+#include "test.h"
+#include "microui/demo.h"
+#include "swrender.h"
+
+#define WIDTH  800
+#define HEIGHT 600
+#define FRAMES 300
+
+static _Alignas(MU_COMMAND_ALIGN) char lin[MU_COMMANDLIST_SIZE];
+static char draws[2][MU_COMMANDLIST_SIZE];
+static unsigned char pixels[2][WIDTH * HEIGHT * 4];
+static char logs[2][4096];
+
+
+static void input(mu_Context *ctx, int f) {
+  int x = 30 + (f * 37) % 700, y = 20 + (f * 23) % 550;
+  mu_input_mousemove(ctx, x, y);
+  if (f % 11 == 3) { mu_input_mousedown(ctx, x, y, MU_MOUSE_LEFT); }
+  if (f % 11 == 5) { mu_input_mouseup(ctx, x, y, MU_MOUSE_LEFT); }
+  if (f % 17 == 8) { mu_input_scroll(ctx, 0, 30); }
+}
+
+
+static void test_walks(void) {
+  mu_Context *ctx = test_context(0);
+  mu_DemoState st;
+  mu_Span spans[256];
+  int f;
+  mu_demo_init(&st, logs[0], sizeof(logs[0]));
+
+  for (f = 0; f < FRAMES; f++) {
+    mu_Command *cmd = NULL;
+    char *span = NULL, *out = lin;
+    int n, i = 0, len;
+    ctx->mode = f & 31;
+    input(ctx, f);
+    mu_begin(ctx);
+    mu_demo_ex(ctx, &st);
+    mu_end(ctx);
+
+    /* spans and the linearized list hold what mu_next_command() returns */
+    n = mu_get_spans(ctx, spans, 256);
+    len = mu_linearize(ctx, lin, sizeof(lin));
+    check(n > 0 && n < 256 && len > 0);
+    if (n > 0) { span = (char*) spans[0].cmd; }
+    while (mu_next_command(ctx, &cmd)) {
+      check((size_t) cmd % MU_COMMAND_ALIGN == 0);
+      check(cmd->base.size % MU_COMMAND_ALIGN == 0);
+      check((char*) cmd == span);
+      check(out + cmd->base.size <= lin + len);
+      if ((char*) cmd != span || out + cmd->base.size > lin + len) { break; }
+      check(memcmp(out, cmd, cmd->base.size) == 0);
+      out += cmd->base.size;
+      span += cmd->base.size;
+      if (span == (char*) spans[i].cmd + spans[i].len) {
+        i++;
+        span = i < n ? (char*) spans[i].cmd : NULL;
+      }
+    }
+    check(i == n && out == lin + len);
+    check(mu_linearize(ctx, lin, len - 1) == 0);
+  }
+  free(ctx);
+}
+
+
+/* writes the draw commands of the last frame to `dst` as text, so that the
+** padding after each is not compared */
+static void draw_commands(mu_Context *ctx, char *dst) {
+  mu_Command *cmd = NULL;
+  *dst = '\0';
+  while (mu_next_command(ctx, &cmd)) {
+    mu_Rect r = cmd->rect.rect;
+    mu_Color c = cmd->rect.color;
+    switch (cmd->type) {
+      case MU_COMMAND_TEXT:
+        r = mu_rect(cmd->text.pos.x, cmd->text.pos.y, cmd->text.width, 0);
+        c = cmd->text.color;
+        break;
+      case MU_COMMAND_ICON:
+        r = cmd->icon.rect;
+        c = cmd->icon.color;
+        break;
+      case MU_COMMAND_CLIP:
+        continue;
+    }
+    dst += sprintf(dst, "%d %d,%d,%d,%d %d,%d,%d,%d %s\n", cmd->type,
+      r.x, r.y, r.w, r.h, c.r, c.g, c.b, c.a,
+      cmd->type == MU_COMMAND_TEXT ? cmd->text.str : "");
+  }
+}
+
+
+static void content(mu_Context *ctx, int y) {
+  mu_draw_rect(ctx, mu_rect(10, y, 30, 4), mu_color(1, 2, 3, 255));
+  mu_draw_text(ctx, NULL, "segment", -1, mu_vec2(10, y + 10), mu_color(4, 5, 6, 255));
+  mu_draw_icon(ctx, MU_ICON_CHECK, mu_rect(50, y, 16, 16), mu_color(7, 8, 9, 255));
+}
+
+
+static void test_segments(void) {
+  mu_Context *ctx = test_context(0);
+  mu_Segment seg = { 0 }, outer = { 0 }, root = { 0 };
+  int f;
+
+  /* reference: everything drawn directly */
+  mu_begin(ctx);
+  if (mu_begin_window(ctx, "W", mu_rect(0, 0, 300, 300))) {
+    content(ctx, 50); content(ctx, 50); content(ctx, 50);
+    mu_draw_rect(ctx, mu_rect(70, 70, 7, 7), mu_color(7, 7, 7, 255));
+    mu_end_window(ctx);
+  }
+  mu_end(ctx);
+  draw_commands(ctx, draws[0]);
+  check(strstr(draws[0], "segment"));
+
+  /* recorded in the first frame, then called; a second call in one frame
+  ** and a call while recording must give the same commands */
+  for (f = 0; f < 3; f++) {
+    mu_begin(ctx);
+    if (mu_begin_window(ctx, "W", mu_rect(0, 0, 300, 300))) {
+      if (f == 0) {
+        mu_begin_segment(ctx, &seg);
+        content(ctx, 50);
+        check(mu_end_segment(ctx, &seg));
+      } else {
+        mu_call_segment(ctx, &seg);
+      }
+      mu_call_segment(ctx, &seg);
+      if (!mu_segment_valid(ctx, &outer)) {
+        mu_begin_segment(ctx, &outer);
+        mu_call_segment(ctx, &seg);
+        mu_draw_rect(ctx, mu_rect(70, 70, 7, 7), mu_color(7, 7, 7, 255));
+        check(mu_end_segment(ctx, &outer));
+      } else {
+        mu_call_segment(ctx, &outer);
+      }
+      mu_end_window(ctx);
+    }
+    mu_end(ctx);
+    check(mu_segment_valid(ctx, &seg) && mu_segment_valid(ctx, &outer));
+    draw_commands(ctx, draws[1]);
+    check(strcmp(draws[0], draws[1]) == 0);
+  }
+
+  /* a window begun while recording is refused */
+  mu_begin(ctx);
+  if (mu_begin_window(ctx, "W", mu_rect(0, 0, 300, 300))) {
+    mu_begin_segment(ctx, &root);
+    if (mu_begin_window(ctx, "Inner", mu_rect(50, 50, 100, 100))) {
+      mu_end_window(ctx);
+    }
+    check(!mu_end_segment(ctx, &root));
+    mu_end_window(ctx);
+  }
+  mu_end(ctx);
+  check(!mu_segment_valid(ctx, &root));
+  free(ctx);
+}
+
+
+static void test_segment_arena(void) {
+  mu_Context *ctx = malloc(sizeof(mu_Context));
+  mu_ContextStorage *cold = malloc(sizeof(mu_ContextStorage));
+  static _Alignas(void*) char commands[1 << 16], segments[1024];
+  mu_Segment seg[64];
+  int i, stored = 0;
+  mu_init_ex(ctx, cold, commands, sizeof(commands), segments, sizeof(segments));
+  ctx->text_width = test_text_width;
+  ctx->text_height = test_text_height;
+  memset(seg, 0, sizeof(seg));
+
+  /* fill the arena until a segment does not fit */
+  mu_begin(ctx);
+  if (mu_begin_window(ctx, "W", mu_rect(0, 0, 300, 300))) {
+    for (i = 0; i < 64; i++) {
+      mu_begin_segment(ctx, &seg[i]);
+      content(ctx, i);
+      if (!mu_end_segment(ctx, &seg[i])) { break; }
+      stored++;
+    }
+    mu_end_window(ctx);
+  }
+  mu_end(ctx);
+  check(stored > 0 && stored < 64);
+  check(mu_segment_valid(ctx, &seg[0]));
+
+  /* which empties it at the next frame, invalidating every segment */
+  mu_begin(ctx);
+  for (i = 0; i < stored; i++) { check(!mu_segment_valid(ctx, &seg[i])); }
+  mu_end(ctx);
+  free(cold);
+  free(ctx);
+}
+
+
+static void demo(mu_Context *ctx, mu_DemoState *st) {
+  mu_demo_ex(ctx, st);
+}
+
+
+/* windows stacked over each other, one nested in another */
+static void overlapping(mu_Context *ctx, mu_DemoState *st) {
+  int i;
+  if (mu_begin_window(ctx, "A", mu_rect(20, 20, 400, 400))) {
+    mu_label(ctx, "lowest");
+    if (mu_begin_window(ctx, "Nested", mu_rect(150, 150, 200, 200))) {
+      mu_label(ctx, "nested");
+      mu_checkbox(ctx, "check", &st->checks[0]);
+      mu_end_window(ctx);
+    }
+    for (i = 0; i < 12; i++) { mu_button(ctx, "button"); }
+    mu_end_window(ctx);
+  }
+  if (mu_begin_window(ctx, "B", mu_rect(100, 100, 300, 300))) {
+    for (i = 0; i < 8; i++) { mu_label(ctx, "middle"); }
+    mu_end_window(ctx);
+  }
+  if (mu_begin_window(ctx, "C", mu_rect(250, 200, 400, 350))) {
+    mu_text(ctx, "topmost window, overlapping the others");
+    mu_end_window(ctx);
+  }
+}
+
+
+/* runs `ui` in two contexts given the same input, with modes `a` and `b`,
+** and compares the pixels swrender.c draws; returns the draw commands of
+** each */
+static void compare_modes(void (*ui)(mu_Context*, mu_DemoState*), int a, int b,
+  int *count_a, int *count_b)
+{
+  mu_Context *ctx[2];
+  mu_DemoState st[2];
+  sw_Canvas canvas[2];
+  int f, k;
+  *count_a = *count_b = 0;
+  for (k = 0; k < 2; k++) {
+    ctx[k] = test_context(k ? b : a);
+    mu_demo_init(&st[k], logs[k], sizeof(logs[k]));
+    sw_init(&canvas[k], pixels[k], WIDTH, HEIGHT);
+  }
+
+  for (f = 0; f < FRAMES; f++) {
+    for (k = 0; k < 2; k++) {
+      mu_Command *cmd = NULL;
+      input(ctx[k], f);
+      mu_begin(ctx[k]);
+      ui(ctx[k], &st[k]);
+      mu_end(ctx[k]);
+      sw_clear(&canvas[k], mu_color(0, 0, 0, 255));
+      sw_render(&canvas[k], ctx[k]);
+      while (mu_next_command(ctx[k], &cmd)) {
+        if (cmd->type != MU_COMMAND_CLIP) { *(k ? count_b : count_a) += 1; }
+      }
+    }
+    check(memcmp(pixels[0], pixels[1], sizeof(pixels[0])) == 0);
+  }
+  free(ctx[0]);
+  free(ctx[1]);
+}
+
+
+static void test_cull(void) {
+  int a, b;
+  compare_modes(overlapping, 0, MU_MODE_CULL, &a, &b);
+  check(b < a);
+  compare_modes(overlapping, MU_MODE_BATCH, MU_MODE_BATCH | MU_MODE_CULL, &a, &b);
+  check(b < a);
+}
+
+
+static void test_coalesce(void) {
+  int a, b;
+  compare_modes(demo, 0, MU_MODE_COALESCE, &a, &b);
+  check(b < a);
+  compare_modes(demo, MU_MODE_LAZYCLIP,
+    MU_MODE_LAZYCLIP | MU_MODE_COALESCE | MU_MODE_CULL, &a, &b);
+  check(b < a);
+}
+
+
+int main(void) {
+  test_walks();
+  test_segments();
+  test_segment_arena();
+  test_cull();
+  test_coalesce();
+  return test_result("commands");
+}
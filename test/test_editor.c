@@ -0,0 +1,169 @@
+/*
+** Piece table of editor.c: random inserts and deletes are mirrored in a
+** plain buffer and the document, its line index and the capacity limits are
+** checked against it.
+*/
+
+#include "test.h"
+#include "microui/editor.h"
+
+#define ORIG_SIZE 3000
+#define EDITS     20000
+
+static char orig[ORIG_SIZE];
+static int orig_nl[ORIG_SIZE];
+static char add[1 << 16];
+static int add_nl[1 << 16];
+static mu_Piece pieces[1 << 14];
+static char ref[1 << 16], buf[1 << 16];
+static int ref_len;
+
+
+static void setup(mu_Editor *ed) {
+  memset(ed, 0, sizeof(*ed));
+  ed->orig_nl = orig_nl; ed->orig_nl_cap = ORIG_SIZE;
+  ed->add = add; ed->add_cap = sizeof(add);
+  ed->add_nl = add_nl; ed->add_nl_cap = sizeof(add_nl) / sizeof(*add_nl);
+  ed->pieces = pieces; ed->piece_cap = sizeof(pieces) / sizeof(*pieces);
+}
+
+
+static void check_document(mu_Editor *ed) {
+  int i, line = 0;
+  check(ed->len == ref_len);
+  check(mu_editor_read(ed, 0, buf, sizeof(buf)) == ref_len);
+  check(memcmp(buf, ref, ref_len) == 0);
+  for (i = 0; i <= ref_len; i++) {
+    check(mu_editor_line_of(ed, i) == line);
+    if (i < ref_len && ref[i] == '\n') {
+      line++;
+      check(mu_editor_line_start(ed, line) == i + 1);
+    }
+  }
+  check(ed->lines == line);
+}
+
+
+static void test_edits(void) {
+  mu_Editor ed;
+  int i;
+  srand(1);
+  for (i = 0; i < ORIG_SIZE; i++) {
+    orig[i] = rand() % 10 ? 'a' + rand() % 26 : '\n';
+  }
+  setup(&ed);
+  check(mu_editor_init(&ed, orig, ORIG_SIZE) == ORIG_SIZE);
+  memcpy(ref, orig, ORIG_SIZE);
+  ref_len = ORIG_SIZE;
+
+  for (i = 0; i < EDITS; i++) {
+    int pos = rand() % (ref_len + 1);
+    int n, j;
+    if (rand() % 3) {
+      char text[8];
+      n = 1 + rand() % 7;
+      for (j = 0; j < n; j++) { text[j] = rand() % 5 ? 'A' + rand() % 26 : '\n'; }
+      check(mu_editor_insert(&ed, pos, text, n) == n);
+      memmove(ref + pos + n, ref + pos, ref_len - pos);
+      memcpy(ref + pos, text, n);
+      ref_len += n;
+    } else {
+      n = mu_min(rand() % 8, ref_len - pos);
+      mu_editor_delete(&ed, pos, n);
+      memmove(ref + pos, ref + pos + n, ref_len - pos - n);
+      ref_len -= n;
+    }
+    if (i % 1000 == 0) { check_document(&ed); }
+  }
+  check_document(&ed);
+}
+
+
+static void test_limits(void) {
+  mu_Editor ed;
+  const char *text = "a\nb\nc\nd";
+
+  /* text with more lines than orig_nl can index is cut short */
+  setup(&ed);
+  ed.orig_nl_cap = 2;
+  check(mu_editor_init(&ed, text, 7) == 5);
+  check(ed.len == 5 && ed.lines == 2);
+
+  setup(&ed);
+  ed.piece_cap = 0;
+  check(mu_editor_init(&ed, text, 7) == 0);
+  check(ed.len == 0);
+
+  /* inserts are truncated to the room left in the add buffer... */
+  setup(&ed);
+  ed.add_cap = 4;
+  mu_editor_init(&ed, text, 7);
+  check(mu_editor_insert(&ed, 0, "xyzzy", 5) == 4);
+  check(mu_editor_insert(&ed, 0, "x", 1) == 0);
+  check(ed.len == 11);
+
+  /* ...and in its newline index */
+  setup(&ed);
+  ed.add_nl_cap = 1;
+  mu_editor_init(&ed, text, 7);
+  check(mu_editor_insert(&ed, 7, "e\nf\ng", 5) == 3);
+  check(ed.lines == 4);
+
+  /* an edit needing more pieces than there is room for does nothing */
+  setup(&ed);
+  ed.piece_cap = 1;
+  mu_editor_init(&ed, text, 7);
+  check(mu_editor_insert(&ed, 3, "x", 1) == 0);
+  mu_editor_delete(&ed, 2, 2);
+  check(ed.len == 7 && ed.piece_count == 1);
+}
+
+
+static void frame(mu_Context *ctx, mu_Editor *ed) {
+  mu_begin(ctx);
+  if (mu_begin_window(ctx, "Editor", mu_rect(0, 0, 400, 300))) {
+    mu_layout_row(ctx, 1, (int[]) { -1 }, -1);
+    mu_editor(ctx, ed, 0);
+    mu_end_window(ctx);
+  }
+  mu_end(ctx);
+}
+
+
+static void test_widget(void) {
+  mu_Context *ctx = test_context(0);
+  mu_Editor ed;
+  const char *text = "first\nsecond\nthird";
+  setup(&ed);
+  mu_editor_init(&ed, text, strlen(text));
+
+  /* hover, click to focus, then type and move down a line */
+  frame(ctx, &ed);
+  mu_input_mousemove(ctx, 20, 40);
+  frame(ctx, &ed);
+  mu_input_mousedown(ctx, 20, 40, MU_MOUSE_LEFT);
+  frame(ctx, &ed);
+  mu_input_mouseup(ctx, 20, 40, MU_MOUSE_LEFT);
+  frame(ctx, &ed);
+  ed.cursor = 0;
+  mu_input_text(ctx, ">");
+  frame(ctx, &ed);
+  mu_input_keydown(ctx, MU_KEY_DOWN);
+  frame(ctx, &ed);
+  mu_input_keyup(ctx, MU_KEY_DOWN);
+  mu_input_text(ctx, "<");
+  frame(ctx, &ed);
+
+  check(mu_editor_read(&ed, 0, buf, sizeof(buf)) == ed.len);
+  check(ed.len == 20 && memcmp(buf, ">first\ns<econd\nthird", 20) == 0);
+  check(mu_editor_line_of(&ed, ed.cursor) == 1);
+  free(ctx);
+}
+
+
+int main(void) {
+  test_edits();
+  test_limits();
+  test_widget();
+  return test_result("editor");
+}
@@ -0,0 +1,99 @@
+/*
+** The event inbox (MU_INBOX): one thread posts events while another builds
+** frames, and every event posted must come out of mu_next_event() once, in
+** order, with its text whole.
+*/
+
+#include <pthread.h>
+#include "test.h"
+
+#define EVENTS 200000
+#define TEXT_EVERY 1000
+
+static mu_Context *ctx;
+static int posted, done;
+static int received, last = -1;
+static char text[64], joined[64];
+
+
+/* long enough to be split over several inbox slots */
+static void format_text(char *dst, int i) {
+  sprintf(dst, "event %d, h\xc3\xa9llo w\xc3\xb6rld \xe2\x9c\x93\xe2\x9c\x93", i);
+}
+
+
+static void* producer(void *udata) {
+  int i;
+  (void) udata;
+  for (i = 0; i < EVENTS; i++) {
+    mu_Event ev;
+    char buf[64];
+    memset(&ev, 0, sizeof(ev));
+    ev.type = MU_EVENT_MOUSEMOVE;
+    ev.pos = mu_vec2(i, 0);
+    if (i % TEXT_EVERY == 0) {
+      format_text(buf, i);
+      ev.type = MU_EVENT_TEXT;
+      ev.text = buf;
+    }
+    if (mu_post_event(ctx, &ev)) { posted++; }
+  }
+  __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+
+static void receive(int i) {
+  check(i > last);
+  last = i;
+  received++;
+}
+
+
+/* text split over inbox slots arrives as consecutive text events */
+static void receive_text(void) {
+  int i = -1;
+  if (!joined[0]) { return; }
+  check(sscanf(joined, "event %d", &i) == 1);
+  check(i % TEXT_EVERY == 0);
+  format_text(text, i);
+  check(strcmp(joined, text) == 0);
+  receive(i);
+  joined[0] = '\0';
+}
+
+
+int main(void) {
+  pthread_t thread;
+  int finished = 0;
+  ctx = test_context(0);
+  pthread_create(&thread, NULL, producer, NULL);
+
+  /* one more frame after the producer is done drains what is left */
+  while (finished < 2) {
+    mu_Event *ev = NULL;
+    if (__atomic_load_n(&done, __ATOMIC_ACQUIRE)) { finished++; }
+    mu_begin(ctx);
+    while (mu_next_event(ctx, &ev)) {
+      if (ev->type == MU_EVENT_TEXT) {
+        check(strlen(joined) + strlen(ev->text) < sizeof(joined));
+        strncat(joined, ev->text, sizeof(joined) - strlen(joined) - 1);
+        continue;
+      }
+      receive_text();
+      check(ev->type == MU_EVENT_MOUSEMOVE);
+      receive(ev->pos.x);
+    }
+    receive_text();
+    if (mu_begin_window(ctx, "Window", mu_rect(0, 0, 100, 100))) {
+      mu_end_window(ctx);
+    }
+    mu_end(ctx);
+  }
+  pthread_join(thread, NULL);
+
+  check(posted > 0);
+  check(received == posted);
+  free(ctx);
+  return test_result("inbox");
+}